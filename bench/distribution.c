@@ -0,0 +1,116 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../src/bitfield.h"
+#include "../src/distribution.h"
+#include "../src/platform.h"
+#include "../src/random.h"
+
+// compares the weight table and SIMD kernels for a field's weight sums, build with make bench
+// hot runs sum with one distribution so its tables stay in cache, cold runs go round many so the tables have to be fetched
+// the size of the table pool is what areas pick their kernel by, see SIMD_SUMS_MIN_TABLE_POOL_SIZE
+
+#define FIELD_COUNT 256
+#define SUMS_PER_RUN (1 << 20)
+#define REPEATS 3  // the fastest of a few runs is kept, it's the least disturbed by everything else on the machine
+
+const char* kernel_names[2] = {"tables", "simd"};
+
+// tile fields with about one in density tiles left
+BitField create_random_tile_fields(int tile_field_size, int density, RandomStream* random) {
+	BitField fields = field_create_empty_array(FIELD_COUNT, tile_field_size);
+
+	for (int i = 0; i < FIELD_COUNT; i++) {
+		BitField field = field_index_array(fields, tile_field_size, i);
+
+		for (int tile = 0; tile < tile_field_size * 8; tile++) {
+			if (random_below(random, density) == 0) field_set_bit(field, tile);
+		}
+	}
+
+	return fields;
+}
+
+// nanoseconds for one sum, the fields and areas are gone through in turn
+double time_sums(DistributionSelection* selections, int area_count, BitField fields, int tile_field_size, int use_simd_sums) {
+	double best = 0;
+	Entropy total = 0;
+
+	for (int i = 0; i < area_count; i++) {
+		selections[i].area->use_simd_sums = use_simd_sums;
+	}
+
+	for (int repeat = 0; repeat < REPEATS; repeat++) {
+		double start = emscripten_get_now();
+
+		for (int i = 0; i < SUMS_PER_RUN; i++) {
+			Entropy weight_sum, weight_log_weight_sum;
+			distribution_selection_get_weight_sums(&selections[i % area_count], field_index_array(fields, tile_field_size, i % FIELD_COUNT), &weight_sum, &weight_log_weight_sum);
+			total += weight_sum + weight_log_weight_sum;
+		}
+
+		double time = emscripten_get_now() - start;
+		if (repeat == 0 || time < best) best = time;
+	}
+
+	// keeps the sums from being optimized away
+	if (total == 1) printf(" ");
+
+	return best * 1e6 / SUMS_PER_RUN;
+}
+
+int main() {
+	int field_sizes[4] = {8, 16, 32, 64};
+	int area_counts[3] = {1, 48, 192};
+
+	for (int s = 0; s < 4; s++) {
+		int tile_field_size = field_sizes[s];
+		RandomStream random;
+		random_stream_seed(&random, 1, tile_field_size, 0);
+
+		BitField fields = create_random_tile_fields(tile_field_size, 2, &random);
+
+		for (int c = 0; c < 3; c++) {
+			int area_count = area_counts[c];
+			DistributionSelection* selections = calloc_inst(area_count, sizeof(DistributionSelection));
+
+			if (selections == NULL) {
+				fprintf(stderr, "Failed to allocate memory: main()\n");
+				exit(1);
+			}
+
+			// an area of one distribution each, with random weights so no two of them share tables
+			for (int i = 0; i < area_count; i++) {
+				Distribution** distributions = malloc_inst(sizeof(Distribution*));
+				distributions[0] = distribution_create(tile_field_size);
+
+				for (int tile = 0; tile < tile_field_size * 8; tile++) {
+					distribution_add_tile(distributions[0], tile, 1 + random_below(&random, 100));
+				}
+
+				distribution_area_select(&selections[i], distribution_area_create(distributions, 1 << 20, 1), 0, 0);
+			}
+
+			int pool_size = distribution_get_table_pool_size();
+			double times[2];
+
+			for (int kernel = 0; kernel < 2; kernel++) {
+				times[kernel] = time_sums(selections, area_count, fields, tile_field_size, kernel);
+			}
+
+			printf("%4d tiles  %3d areas  %5d KB of tables  %s %6.1f ns  %s %6.1f ns\n", tile_field_size * 8, area_count, pool_size / 1024, kernel_names[0], times[0], kernel_names[1], times[1]);
+
+			for (int i = 0; i < area_count; i++) {
+				DistributionArea* area = selections[i].area;
+				distribution_free(area->distributions[0]);
+				distribution_area_free(area);
+			}
+
+			free_inst(selections);
+		}
+
+		free_inst(fields);
+	}
+
+	return 0;
+}
@@ -0,0 +1,132 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../src/arena.h"
+#include "../src/entropies.h"
+#include "../src/platform.h"
+#include "../src/random.h"
+#include "../src/superposition.h"
+#include "../src/tileset.h"
+#include "../src/world.h"
+
+// compares the heap and bucket entropy queues, build with make bench
+// the first run drives the queue alone the way propagation does, the second generates whole areas
+
+#define MAX_ENTROPY 4000
+
+const char* queue_names[2] = {"heap", "buckets"};
+
+// collapse every tile, each collapse lowers the entropy of its neighbours and now and then raises one like a backtrack would
+double run_queue_only(Entropies* entropies, int size, int rounds) {
+	RandomStream random;
+	random_stream_seed(&random, 1, size, 0);
+
+	double start = emscripten_get_now();
+
+	for (int round = 0; round < rounds; round++) {
+		for (int i = 0; i < size * size; i++) {
+			entropies->tiles[i] = random_below(&random, MAX_ENTROPY);
+		}
+
+		entropies_initalize_from_tiles(entropies, size, size, size * size);
+
+		while (entropies->heap_size > 0) {
+			GenerationTile key = entropies_collapse_least(entropies);
+			int i = key % size, j = key / size;
+			int neighbours[4] = {i + 1 < size ? key + 1 : -1, i > 0 ? key - 1 : -1, j + 1 < size ? key + size : -1, j > 0 ? key - size : -1};
+
+			for (int k = 0; k < 4; k++) {
+				if (neighbours[k] < 0 || entropies_is_collapsed(entropies, neighbours[k])) continue;
+
+				Entropy entropy = entropies->tiles[neighbours[k]];
+				if (random_below(&random, 32) == 0) {
+					entropy += random_below(&random, MAX_ENTROPY / 4);
+				} else {
+					entropy -= random_below(&random, entropy / 4 + 1);
+				}
+
+				entropies_update_entropy(entropies, neighbours[k], entropy);
+			}
+		}
+	}
+
+	return emscripten_get_now() - start;
+}
+
+double run_generation(EntropyQueue queue, int size, int rounds) {
+	Tileset* tileset = tileset_create(1, 2);
+	int dirt = 0, road = 1;
+	int edges[9][4] = {{dirt, dirt, dirt, dirt}, {dirt, dirt, dirt, dirt}, {dirt, road, dirt, road}, {road, dirt, road, dirt}, {dirt, dirt, dirt, road}, {dirt, road, dirt, dirt}, {dirt, dirt, road, dirt}, {road, dirt, dirt, dirt}, {road, road, road, road}};
+	int weights[9] = {50, 10, 10, 10, 2, 2, 2, 2, 1};
+
+	Distribution* distribution = distribution_create(2);
+	for (int tile = 0; tile < 9; tile++) {
+		tileset_add_tile(tileset, tile, 0, edges[tile][0], edges[tile][1], edges[tile][2], edges[tile][3]);
+		distribution_add_tile(distribution, tile, weights[tile]);
+	}
+
+	Distribution** distributions = malloc_inst(sizeof(Distribution*));
+	distributions[0] = distribution;
+	DistributionArea* area = distribution_area_create(distributions, 1 << 20, 1);
+
+	World* world = world_create(size, tileset);
+	Superposition* superposition = superposition_create(world);
+	superposition_set_entropy_queue(superposition, queue);
+	superposition_select_distribution_area(superposition, 0, 0, area);
+
+	double start = emscripten_get_now();
+
+	for (int round = 0; round < rounds; round++) {
+		world_create_chunk(world, round, 0);
+		superposition_select_collapse_area(superposition, round * size, 0, size, size);
+		while (superposition_collapse_tiles(superposition, size * size) == COLLAPSE_UNFINISHED);
+	}
+
+	double time = emscripten_get_now() - start;
+
+	superposition_free(superposition);
+	distribution_area_free(area);
+	distribution_free(distribution);
+	world_free(world);
+	tileset_free(tileset);
+
+	return time;
+}
+
+int main() {
+	int sizes[2] = {64, 256};
+
+	for (int s = 0; s < 2; s++) {
+		int size = sizes[s];
+		int rounds = size == 64 ? 64 : 4;
+
+		Arena* arena = arena_create();
+		arena_reserve(arena, entropies_get_arena_size(size * size));
+
+		for (int queue = ENTROPY_QUEUE_HEAP; queue <= ENTROPY_QUEUE_BUCKETS; queue++) {
+			Entropies* entropies = entropies_create();
+			arena_reset(arena);
+			entropies_allocate(entropies, arena, size * size);
+			entropies->queue = queue;
+
+			double time = run_queue_only(entropies, size, rounds);
+			printf("queue only  %3dx%-3d %-8s %8.3f ms per area\n", size, size, queue_names[queue], time / rounds);
+
+			entropies_free(entropies);
+		}
+
+		arena_free(arena);
+	}
+
+	for (int s = 0; s < 2; s++) {
+		int size = sizes[s];
+		int rounds = size == 64 ? 16 : 2;
+
+		for (int queue = ENTROPY_QUEUE_HEAP; queue <= ENTROPY_QUEUE_BUCKETS; queue++) {
+			double time = run_generation(queue, size, rounds);
+			printf("generation  %3dx%-3d %-8s %8.3f ms per area\n", size, size, queue_names[queue], time / rounds);
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,87 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../src/platform.h"
+#include "../src/scheduler.h"
+#include "../src/tileset.h"
+#include "../src/world.h"
+
+// chunks per second the scheduler generates with 1, 2, 4 and 8 threads, build with make bench
+// every run generates the same square of chunks into a fresh world and checks the edges between all of its tiles
+
+#define CHUNK_SIZE 32
+#define CHUNKS_ACROSS 12
+
+int edges[9][4];
+
+// edges that don't match, within chunks and across their borders
+int count_bad_edges(World* world, int width) {
+	int bad = 0;
+
+	for (int y = 0; y < width; y++) {
+		for (int x = 0; x < width; x++) {
+			int tile = world_get(world, x, y);
+			if (tile < 0) continue;
+
+			int right = x + 1 < width ? world_get(world, x + 1, y) : -1;
+			int up = y + 1 < width ? world_get(world, x, y + 1) : -1;
+
+			if (right >= 0 && edges[tile][0] != edges[right][2]) bad++;
+			if (up >= 0 && edges[tile][1] != edges[up][3]) bad++;
+		}
+	}
+
+	return bad;
+}
+
+int main() {
+	int dirt = 0, road = 1;
+	int tile_edges[9][4] = {{dirt, dirt, dirt, dirt}, {dirt, dirt, dirt, dirt}, {dirt, road, dirt, road}, {road, dirt, road, dirt}, {dirt, dirt, dirt, road}, {dirt, road, dirt, dirt}, {dirt, dirt, road, dirt}, {road, dirt, dirt, dirt}, {road, road, road, road}};
+	int weights[9] = {50, 10, 10, 10, 2, 2, 2, 2, 1};
+
+	Tileset* tileset = tileset_create(1, 2);
+	Distribution* distribution = distribution_create(2);
+
+	for (int tile = 0; tile < 9; tile++) {
+		memcpy(edges[tile], tile_edges[tile], sizeof(edges[tile]));
+		tileset_add_tile(tileset, tile, 0, edges[tile][0], edges[tile][1], edges[tile][2], edges[tile][3]);
+		distribution_add_tile(distribution, tile, weights[tile]);
+	}
+
+	Distribution** distributions = malloc_inst(sizeof(Distribution*));
+	distributions[0] = distribution;
+
+	// the distribution area is centered on the chunks so they're all inside it
+	DistributionArea* area = distribution_area_create(distributions, 1 << 20, 1);
+	int thread_counts[4] = {1, 2, 4, 8};
+
+	for (int t = 0; t < 4; t++) {
+		World* world = world_create(CHUNK_SIZE, tileset);
+		Scheduler* scheduler = scheduler_create(world, -(1 << 19), -(1 << 19), area, thread_counts[t]);
+
+		double start = emscripten_get_now();
+
+		for (int y = 0; y < CHUNKS_ACROSS; y++) {
+			for (int x = 0; x < CHUNKS_ACROSS; x++) {
+				scheduler_queue_chunk(scheduler, x, y);
+			}
+		}
+
+		scheduler_wait(scheduler);
+		double time = emscripten_get_now() - start;
+
+		int generated = scheduler_get_generated(scheduler);
+		int failed = scheduler_get_failed(scheduler);
+		int bad = count_bad_edges(world, CHUNK_SIZE * CHUNKS_ACROSS);
+		printf("%d threads  %3d chunks  %8.1f chunks/s  failed %d  bad edges %d\n", thread_counts[t], generated, generated / time * 1000, failed, bad);
+
+		scheduler_free(scheduler);
+		world_free(world);
+	}
+
+	distribution_area_free(area);
+	distribution_free(distribution);
+	tileset_free(tileset);
+
+	return 0;
+}
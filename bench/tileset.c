@@ -0,0 +1,110 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../src/bitfield.h"
+#include "../src/platform.h"
+#include "../src/random.h"
+#include "../src/tileset.h"
+
+// compares tileset table layouts, build with make bench
+// each step finds the edges of a tile field and constrains another tile field by them, the way propagation does
+
+#define FIELD_COUNT 256
+#define REPEATS 3  // the fastest of a few runs is kept, it's the least disturbed by everything else on the machine
+
+// tiles with random edges, the tileset is full so every table entry is used
+Tileset* create_random_tileset(int edge_field_size, int tile_field_size, int table_chunk_bits, RandomStream* random) {
+	Tileset* tileset = tileset_create_with_chunk_bits(edge_field_size, tile_field_size, table_chunk_bits);
+
+	for (int tile = 0; tile < tile_field_size * 8; tile++) {
+		int right = random_below(random, edge_field_size * 8), top = random_below(random, edge_field_size * 8);
+		int left = random_below(random, edge_field_size * 8), bottom = random_below(random, edge_field_size * 8);
+		tileset_add_tile(tileset, tile, 0, right, top, left, bottom);
+	}
+
+	return tileset;
+}
+
+// tile fields with about one in density tiles left
+BitField create_random_tile_fields(int tile_field_size, int density, RandomStream* random) {
+	BitField fields = field_create_empty_array(FIELD_COUNT, tile_field_size);
+
+	for (int i = 0; i < FIELD_COUNT; i++) {
+		BitField field = field_index_array(fields, tile_field_size, i);
+
+		for (int tile = 0; tile < tile_field_size * 8; tile++) {
+			if (random_below(random, density) == 0) field_set_bit(field, tile);
+		}
+	}
+
+	return fields;
+}
+
+// ns per step
+double run_propagation(Tileset* tileset, BitField fields, int steps) {
+	int tile_field_size = tileset->tile_field_size, edge_field_size = tileset->edge_field_size;
+	BitField edge_fields = field_create_empty_array(4, edge_field_size);
+	BitField tile_field = field_create(tile_field_size);
+	int checksum = 0;
+
+	double start = emscripten_get_now();
+
+	for (int step = 0; step < steps; step++) {
+		tileset_find_tile_edges(tileset, field_index_array(fields, tile_field_size, step % FIELD_COUNT), edge_fields);
+
+		field_copy(tile_field, field_index_array(fields, tile_field_size, (step * 7 + 1) % FIELD_COUNT), tile_field_size);
+		tileset_constrain_tile(tileset, tile_field, field_index_array(edge_fields, edge_field_size, step % 4), (step + 2) % 4);
+		checksum += field_get_byte(tile_field, 0);
+	}
+
+	double time = emscripten_get_now() - start;
+
+	// keeps the work from being optimised out
+	if (checksum == -1) printf("\n");
+
+	free_inst(edge_fields);
+	free_inst(tile_field);
+
+	return time * 1000000 / steps;
+}
+
+int main() {
+	int field_sizes[5] = {2, 4, 8, 16, 32};	// bytes, used for both edge and tile fields
+	int densities[2] = {2, 16};
+	const char* density_names[2] = {"dense", "sparse"};
+
+	int chunk_bits[3] = {8, 4, 1};
+
+	printf("%-17s %10s %10s %10s %10s\n", "", "8 bit", "4 bit", "1 bit", "chosen");
+
+	for (int s = 0; s < 5; s++) {
+		int size = field_sizes[s];
+		RandomStream random;
+
+		for (int d = 0; d < 2; d++) {
+			double times[3];
+
+			for (int c = 0; c < 3; c++) {
+				random_stream_seed(&random, 1, size, d);
+				Tileset* tileset = create_random_tileset(size, size, chunk_bits[c], &random);
+				BitField fields = create_random_tile_fields(size, densities[d], &random);
+
+				for (int repeat = 0; repeat < REPEATS; repeat++) {
+					double time = run_propagation(tileset, fields, 4000000 / size);
+					if (repeat == 0 || time < times[c]) times[c] = time;
+				}
+
+				free_inst(fields);
+				tileset_free(tileset);
+			}
+
+			Tileset* tileset = tileset_create(size, size);
+			printf("%3d tiles %-7s %7.1f ns %7.1f ns %7.1f ns %6d bit\n", size * 8, density_names[d], times[0], times[1], times[2], tileset->table_chunk_bits);
+			tileset_free(tileset);
+		}
+
+		printf("%3d tiles tables  %7d KB %7d KB %7d KB\n", size * 8, tileset_get_table_size(size, size, 8) / 1024, tileset_get_table_size(size, size, 4) / 1024, tileset_get_table_size(size, size, 1) / 1024);
+	}
+
+	return 0;
+}
@@ -0,0 +1,56 @@
+#include "arena.h"
+
+void arena_free(Arena* arena) {
+	free_inst(arena->memory);
+	free_inst(arena);
+}
+
+// make sure the arena holds at least size bytes, growing it throws away everything in it
+// memory is zeroed when it's first allocated, after that it holds whatever was last written to it
+void arena_reserve(Arena* arena, size_t size) {
+	arena->used = 0;
+	if (size <= arena->size) return;
+
+	free_inst(arena->memory);
+	arena->memory = calloc_inst(1, size);
+
+	if (arena->memory == NULL) {
+		fprintf(stderr, "Failed to allocate memory: arena_reserve()\n");
+		exit(1);
+	}
+
+	arena->size = size;
+}
+
+void* arena_alloc(Arena* arena, size_t size) {
+	size = arena_aligned_size(size);
+
+	if (arena->used + size > arena->size) {
+		fprintf(stderr, "Arena is out of space: arena_alloc()\n");
+		exit(1);
+	}
+
+	void* ptr = arena->memory + arena->used;
+	arena->used += size;
+
+	return ptr;
+}
+
+void arena_reset(Arena* arena) {
+	arena->used = 0;
+}
+
+Arena* arena_create() {
+	Arena* arena = malloc_inst(sizeof(Arena));
+
+	if (arena == NULL) {
+		fprintf(stderr, "Failed to allocate memory: arena_create()\n");
+		exit(1);
+	}
+
+	arena->memory = NULL;
+	arena->size = 0;
+	arena->used = 0;
+
+	return arena;
+}
@@ -0,0 +1,28 @@
+#ifndef ARENA_GUARD
+#define ARENA_GUARD
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "meminst.h"
+
+// pieces are aligned for v128 loads
+#define ARENA_ALIGNMENT 16
+#define arena_aligned_size(a) (((a) + ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT * ARENA_ALIGNMENT)
+
+// one block of scratch memory handed out in pieces, the pieces are all given back at once by resetting it
+// the block only ever grows, so once it has reached its high water mark nothing more is allocated
+typedef struct {
+	uint8_t* memory;
+	size_t size;
+	size_t used;
+} Arena;
+
+Arena* arena_create();
+void arena_reserve(Arena* arena, size_t size);
+void* arena_alloc(Arena* arena, size_t size);
+void arena_reset(Arena* arena);
+void arena_free(Arena* arena);
+
+#endif
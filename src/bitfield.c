@@ -3,6 +3,12 @@
 #define bit_field_storage_byte_size(a) (bit_field_storage_frame_size(a) * BIT_FIELD_FRAME_SIZE)
 #define bit_field_storage_type_size(a, b) (bit_field_storage_byte_size(a) / sizeof(b))
 
+// native AVX2 builds work on two frames at a time, the loops over single frames finish off odd ones
+#ifdef __AVX2__
+#define wide_frame_load(p) _mm256_loadu_si256((const __m256i*)(p))
+#define wide_frame_store(p, a) _mm256_storeu_si256((__m256i*)(p), a)
+#endif
+
 BitField field_create(int size) {
 	BitField field = calloc_inst(1, bit_field_storage_byte_size(size));
 
@@ -61,8 +67,15 @@ void field_clear(BitField field, int size) {
 
 void field_or(BitField field_dest, BitField field_src, int size) {
 	v128_t a, b;
+	int i = 0;
+
+#ifdef __AVX2__
+	for (; i + 2 <= bit_field_storage_frame_size(size); i += 2) {
+		wide_frame_store(field_dest + i, _mm256_or_si256(wide_frame_load(field_dest + i), wide_frame_load(field_src + i)));
+	}
+#endif
 
-	for (int i = 0; i < bit_field_storage_frame_size(size); i++) {
+	for (; i < bit_field_storage_frame_size(size); i++) {
 		a = wasm_v128_load(field_dest + i);
 		b = wasm_v128_load(field_src + i);
 		a = wasm_v128_or(a, b);
@@ -72,8 +85,15 @@ void field_or(BitField field_dest, BitField field_src, int size) {
 
 void field_and(BitField field_dest, BitField field_src, int size) {
 	v128_t a, b;
+	int i = 0;
+
+#ifdef __AVX2__
+	for (; i + 2 <= bit_field_storage_frame_size(size); i += 2) {
+		wide_frame_store(field_dest + i, _mm256_and_si256(wide_frame_load(field_dest + i), wide_frame_load(field_src + i)));
+	}
+#endif
 
-	for (int i = 0; i < bit_field_storage_frame_size(size); i++) {
+	for (; i < bit_field_storage_frame_size(size); i++) {
 		a = wasm_v128_load(field_dest + i);
 		b = wasm_v128_load(field_src + i);
 		a = wasm_v128_and(a, b);
@@ -84,8 +104,25 @@ void field_and(BitField field_dest, BitField field_src, int size) {
 int field_popcnt(BitField field, int size) {
 	v128_t a, b;
 	int sum = 0;
+	int i = 0;
+
+#ifdef __AVX2__
+	// bits in each nibble are looked up with a byte shuffle, then the bytes are summed into 64 bit lanes
+	__m256i nibble_popcnts = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+	__m256i nibble_mask = _mm256_set1_epi8(0x0F);
+	__m256i sums = _mm256_setzero_si256();
+
+	for (; i + 2 <= bit_field_storage_frame_size(size); i += 2) {
+		__m256i frames = wide_frame_load(field + i);
+		__m256i low = _mm256_shuffle_epi8(nibble_popcnts, _mm256_and_si256(frames, nibble_mask));
+		__m256i high = _mm256_shuffle_epi8(nibble_popcnts, _mm256_and_si256(_mm256_srli_epi16(frames, 4), nibble_mask));
+		sums = _mm256_add_epi64(sums, _mm256_sad_epu8(_mm256_add_epi8(low, high), _mm256_setzero_si256()));
+	}
+
+	sum += _mm256_extract_epi64(sums, 0) + _mm256_extract_epi64(sums, 1) + _mm256_extract_epi64(sums, 2) + _mm256_extract_epi64(sums, 3);
+#endif
 
-	for (int i = 0; i < bit_field_storage_frame_size(size); i++) {
+	for (; i < bit_field_storage_frame_size(size); i++) {
 		a = wasm_v128_load(field + i);
 		a = wasm_i8x16_popcnt(a);
 
@@ -118,6 +155,17 @@ void field_set_bit(BitField field, int bit) {
 	*byte |= 1 << (bit % 8);
 }
 
+void field_clear_bit(BitField field, int bit) {
+	uint8_t *byte = (uint8_t *)field;
+	byte += bit / 8;
+	*byte &= ~(1 << (bit % 8));
+}
+
+int field_get_bit(BitField field, int bit) {
+	uint8_t *bytes = (uint8_t *)field;
+	return (bytes[bit / 8] >> (bit % 8)) & 1;
+}
+
 int field_get_rightmost_bit(BitField field, int size, int starting_index) {
 	uint32_t *words = (uint32_t *)field;
 	int inital_word_index = starting_index / sizeof(uint32_t) / 8;
@@ -125,19 +173,86 @@ int field_get_rightmost_bit(BitField field, int size, int starting_index) {
 	for (int i = inital_word_index; i < bit_field_storage_type_size(size, uint32_t); i++) {
 		uint32_t test_word = words[i];
 		if (i == inital_word_index) {
-			test_word &= 0xFFFFFFFF << starting_index;
+			test_word &= 0xFFFFFFFF << (starting_index % 32);
 		}
 
 		if (test_word == 0) continue;
 
 		int zeros = __builtin_ctz(test_word);
 		if (zeros < sizeof(uint32_t) * 8)
-			return i * sizeof(uint32_t) + zeros;
+			return i * sizeof(uint32_t) * 8 + zeros;
 	}
 
 	return NO_MORE_BITS;
 }
 
+// 64 bits of the field starting at bit word * 64, bytes past size are left out
+uint64_t field_get_word(BitField field, int size, int word) {
+	uint64_t bits;
+	memcpy(&bits, (uint8_t *)field + word * sizeof(uint64_t), sizeof(uint64_t));
+
+	int bytes_left = size - word * (int)sizeof(uint64_t);
+	if (bytes_left < (int)sizeof(uint64_t)) bits &= ((uint64_t)1 << bytes_left * 8) - 1;
+
+	return bits;
+}
+
+// index of the set bit with rank set bits below it, rank has to be less than the number of set bits
+int word_select_bit(uint64_t word, int rank) {
+	int shift = 0;
+
+	// whole bytes are skipped by their popcount first
+	while (__builtin_popcount((word >> shift) & 0xFF) <= rank) {
+		rank -= __builtin_popcount((word >> shift) & 0xFF);
+		shift += 8;
+	}
+
+	uint32_t byte = (word >> shift) & 0xFF;
+	for (; rank > 0; rank--) byte &= byte - 1;
+
+	return shift + __builtin_ctz(byte);
+}
+
+// unrolled kernels, frames is a constant in each caller so the loops go away and fields stay in registers
+#define FIELD_KERNEL inline __attribute__((always_inline))
+
+static FIELD_KERNEL void field_copy_frames(BitField field_dest, BitField field_src, int frames) {
+	for (int i = 0; i < frames; i++) wasm_v128_store(field_dest + i, wasm_v128_load(field_src + i));
+}
+
+// field_andnot_changes with a frame count, the flags are found the same way as tileset_constrain_tile's
+static FIELD_KERNEL int field_andnot_changes_frames(BitField field_dest, BitField field_src, int frames) {
+	v128_t any_removed = wasm_i32x4_splat(0), any_left = wasm_i32x4_splat(0);
+
+	for (int i = 0; i < frames; i++) {
+		v128_t a = wasm_v128_load(field_dest + i);
+		v128_t left = wasm_v128_andnot(a, wasm_v128_load(field_src + i));
+
+		wasm_v128_store(field_dest + i, left);
+		any_removed = wasm_v128_or(any_removed, wasm_v128_xor(a, left));
+		any_left = wasm_v128_or(any_left, left);
+	}
+
+	return (wasm_v128_any_true(any_removed) ? FIELD_CHANGED : 0) | (wasm_v128_any_true(any_left) ? 0 : FIELD_EMPTY);
+}
+
+// clear the bits of field_src from field_dest, returns FIELD_CHANGED if it cleared any and FIELD_EMPTY if none are left
+int field_andnot_changes(BitField field_dest, BitField field_src, int size) {
+	return field_andnot_changes_frames(field_dest, field_src, bit_field_storage_frame_size(size));
+}
+
+#define define_field_kernels(frames)                                                                                                                            \
+	void field_copy_##frames(BitField field_dest, BitField field_src, int size) { field_copy_frames(field_dest, field_src, frames); }                           \
+	int field_andnot_changes_##frames(BitField field_dest, BitField field_src, int size) { return field_andnot_changes_frames(field_dest, field_src, frames); } \
+	const FieldKernels field_kernels_##frames = {field_copy_##frames, field_andnot_changes_##frames};
+
+// 128, 256 and 512 bits
+define_field_kernels(1)
+define_field_kernels(2)
+define_field_kernels(4)
+
+const FieldKernels field_kernels_generic = {field_copy, field_andnot_changes};
+
 void field_print(BitField field, int size) {
 	uint8_t *bytes = (uint8_t *)field;
 
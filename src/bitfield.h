@@ -5,17 +5,31 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <wasm_simd128.h>
 
 #include "meminst.h"
+#include "simd.h"
 
 #define BIT_FIELD_FRAME_SIZE 16
 #define bit_field_storage_frame_size(a) ((a + BIT_FIELD_FRAME_SIZE - 1) / BIT_FIELD_FRAME_SIZE)
 #define NO_MORE_BITS -1
+#define bit_field_word_size(a) ((a + 7) / 8)  // number of 64 bit words covering a bytes
+
+// what an operation did to its destination field
+#define FIELD_CHANGED 1
+#define FIELD_EMPTY 2
 
 typedef v128_t BitFieldFrame;
 typedef BitFieldFrame* BitField;
 
+// field operations for one field size, the common sizes have versions unrolled at compile time
+// they take the same arguments as the field_ functions, the size is ignored by the unrolled ones
+typedef struct {
+	void (*copy)(BitField field_dest, BitField field_src, int size);
+	int (*andnot)(BitField field_dest, BitField field_src, int size);  // see field_andnot_changes
+} FieldKernels;
+
+extern const FieldKernels field_kernels_1, field_kernels_2, field_kernels_4, field_kernels_generic;
+
 BitField field_create(int size);
 BitField field_create_junk_array(int count, int elm_size);
 BitField field_create_empty_array(int count, int elm_size);
@@ -25,10 +39,15 @@ void field_copy(BitField field_dest, BitField field_src, int size);
 void field_clear(BitField field, int size);
 void field_or(BitField field_dest, BitField field_src, int size);
 void field_and(BitField field_dest, BitField field_src, int size);
+int field_andnot_changes(BitField field_dest, BitField field_src, int size);
 int field_popcnt(BitField field, int size);
 uint8_t field_get_byte(BitField field, int byte);
 void field_set_bit(BitField field, int bit);
+void field_clear_bit(BitField field, int bit);
+int field_get_bit(BitField field, int bit);
 int field_get_rightmost_bit(BitField field, int size, int starting_index);
+uint64_t field_get_word(BitField field, int size, int word);
+int word_select_bit(uint64_t word, int rank);
 void field_print(BitField field, int size);
 
 #endif
\ No newline at end of file
@@ -1,8 +1,11 @@
 import { init as initDistribution } from "./distribution.ts";
+import { init as initGenqueue } from "./genqueue.ts";
 import { init as initList } from "./list.ts";
 import { init as initMeminst } from "./meminst.ts";
+import { init as initScheduler } from "./scheduler.ts";
 import { init as initSuperposition } from "./superposition.ts";
 import { init as initTileset } from "./tileset.ts";
+import { init as initTilesetFile } from "./tilesetfile.ts";
 import { init as initWorld } from "./world.ts";
 
 declare const Module: EmscriptenModule;
@@ -22,10 +25,13 @@ export async function init() {
     heapU32 = Module.HEAPU32;
 
     initDistribution();
+    initGenqueue();
     initList();
     initMeminst();
+    initScheduler();
     initSuperposition();
     initTileset();
+    initTilesetFile();
     initWorld();
 }
 
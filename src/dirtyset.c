@@ -0,0 +1,53 @@
+#include "dirtyset.h"
+
+// the arrays belong to the arena they were allocated from
+void dirtyset_free(DirtySet* set) {
+	free_inst(set);
+}
+
+void dirtyset_add(DirtySet* set, uint32_t index) {
+	if (field_get_bit(set->members, index)) return;
+
+	field_set_bit(set->members, index);
+	set->indices[set->length] = index;
+	set->length++;
+}
+
+// only the listed indices are unset, so clearing costs no more than the pass that used them
+void dirtyset_clear(DirtySet* set) {
+	for (int i = 0; i < set->length; i++) {
+		field_clear_bit(set->members, set->indices[i]);
+	}
+
+	set->length = 0;
+}
+
+// bytes dirtyset_allocate takes from an arena
+size_t dirtyset_get_arena_size(int capacity) {
+	return arena_aligned_size(capacity * sizeof(uint32_t)) + arena_aligned_size((capacity + 7) / 8);
+}
+
+// give the set room for capacity indices, the set is emptied
+// the bitmap has to come from zeroed memory or be left clean by dirtyset_clear
+void dirtyset_allocate(DirtySet* set, Arena* arena, int capacity) {
+	set->indices = arena_alloc(arena, capacity * sizeof(uint32_t));
+	set->members = arena_alloc(arena, (capacity + 7) / 8);
+	set->length = 0;
+	set->capacity = capacity;
+}
+
+DirtySet* dirtyset_create() {
+	DirtySet* set = malloc_inst(sizeof(DirtySet));
+
+	if (set == NULL) {
+		fprintf(stderr, "Failed to allocate memory: dirtyset_create()\n");
+		exit(1);
+	}
+
+	set->indices = NULL;
+	set->members = NULL;
+	set->length = 0;
+	set->capacity = 0;
+
+	return set;
+}
@@ -0,0 +1,28 @@
+#ifndef DIRTYSET_GUARD
+#define DIRTYSET_GUARD
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "arena.h"
+#include "bitfield.h"
+#include "meminst.h"
+
+// set of indices below a capacity, used to remember what needs updating
+// a bitmap stops duplicates and a list of the added indices means the bitmap never needs scanning
+typedef struct {
+	uint32_t* indices;
+	BitField members;
+	int length;
+	int capacity;
+} DirtySet;
+
+DirtySet* dirtyset_create();
+size_t dirtyset_get_arena_size(int capacity);
+void dirtyset_allocate(DirtySet* set, Arena* arena, int capacity);
+void dirtyset_add(DirtySet* set, uint32_t index);
+void dirtyset_clear(DirtySet* set);
+void dirtyset_free(DirtySet* set);
+
+#endif
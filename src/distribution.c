@@ -1,176 +1,563 @@
 #include "distribution.h"
 
-// set of selected distributions
-struct {
-	Distribution* distributions[4];
-	int length;
-} set;
+// weight tables in use by any distribution, keyed by a hash of their tile weights
+// distributions are only created and changed from one thread, so the pool isn't locked
+Hashmap* weight_table_pool = NULL;
+int weight_table_pool_size = 0;
+
+void release_weight_table(WeightTable* table) {
+	if (--table->reference_count > 0) return;
+
+	WeightTable* first = hashmap_get(weight_table_pool, table->key);
+
+	if (first == table) {
+		if (table->next == NULL) {
+			hashmap_delete(weight_table_pool, table->key);
+		} else {
+			hashmap_set(weight_table_pool, table->key, table->next);
+		}
+	} else {
+		while (first->next != table) first = first->next;
+		first->next = table->next;
+	}
+
+	weight_table_pool_size -= sizeof(WeightTable);
+	free_inst(table);
+}
+
+// find a table for these weights in the pool, or make one
+WeightTable* acquire_weight_table(Entropy* weights, Entropy* weight_log_weights) {
+	if (weight_table_pool == NULL) weight_table_pool = hashmap_create(64);
+
+	Entropy key_weights[16];
+	memcpy(key_weights, weights, 8 * sizeof(Entropy));
+	memcpy(key_weights + 8, weight_log_weights, 8 * sizeof(Entropy));
+	uint64_t key = jenkins_hash(sizeof(key_weights), (uint8_t*)key_weights);
+
+	WeightTable* first = hashmap_get(weight_table_pool, key);
+
+	for (WeightTable* table = first; table != NULL; table = table->next) {
+		if (memcmp(table->weights, weights, 8 * sizeof(Entropy)) == 0 && memcmp(table->weight_log_weights, weight_log_weights, 8 * sizeof(Entropy)) == 0) {
+			table->reference_count++;
+			return table;
+		}
+	}
+
+	WeightTable* table = malloc_inst(sizeof(WeightTable));
+
+	if (table == NULL) {
+		fprintf(stderr, "Failed to allocate memory: acquire_weight_table()\n");
+		exit(1);
+	}
+
+	memcpy(table->weights, weights, 8 * sizeof(Entropy));
+	memcpy(table->weight_log_weights, weight_log_weights, 8 * sizeof(Entropy));
+	table->reference_count = 1;
+	table->key = key;
+
+	// each byte value adds its lowest tile to the value without it
+	table->sums[0][0] = 0;
+	table->sums[0][1] = 0;
+
+	for (int byte = 1; byte < 256; byte++) {
+		int tile = __builtin_ctz(byte);
+		table->sums[byte][0] = table->sums[byte & (byte - 1)][0] + weights[tile];
+		table->sums[byte][1] = table->sums[byte & (byte - 1)][1] + weight_log_weights[tile];
+	}
+
+	table->next = first;
+	hashmap_set(weight_table_pool, key, table);
+	weight_table_pool_size += sizeof(WeightTable);
+
+	return table;
+}
+
+// swap the table for one byte of the distribution for one matching its weights
+void update_weight_table(Distribution* distribution, int byte) {
+	WeightTable* table = acquire_weight_table(distribution->weights + byte * 8, distribution->weight_log_weights + byte * 8);
+	release_weight_table(distribution->tables[byte]);
+	distribution->tables[byte] = table;
+}
+
+// bytes held by weight tables, shared between every distribution
+int distribution_get_table_pool_size() {
+	return weight_table_pool_size;
+}
 
 void distribution_free(Distribution* distribution) {
+	for (int i = 0; i < distribution->tile_field_size; i++) {
+		release_weight_table(distribution->tables[i]);
+	}
+
 	free_inst(distribution->weights);
-	free_inst(distribution->weight_table);
-	free_inst(distribution->weight_log_weight_table);
+	free_inst(distribution->tables);
+	free_inst(distribution->weight_log_weights);
+	free_inst(distribution->all_tiles);
+	free_inst(distribution->alias_tiles);
+	free_inst(distribution->alias_others);
+	free_inst(distribution->alias_thresholds);
 	free_inst(distribution);
 }
 
+void distribution_area_clear_cache(DistributionArea* area) {
+	for (int i = 0; i < area->merge_count; i++) {
+		if (area->merges[i].length > 1) distribution_free(area->merges[i].merged);
+	}
+
+	free_inst(area->merges);
+	free_inst(area->cell_distributions);
+
+	area->merges = NULL;
+	area->merge_count = 0;
+	area->cell_distributions = NULL;
+	area->cache_size = 0;
+}
+
 void distribution_area_free(DistributionArea* area) {
+	distribution_area_clear_cache(area);
 	free_inst(area->distributions);
 	free_inst(area);
 }
 
-int distribution_pick_random_unweighted(BitField field) {
+int distribution_area_get_cache_size(DistributionArea* area) {
+	return area->cache_size;
+}
+
+// fields are walked 64 tiles at a time, words without any tiles left are skipped
+int distribution_pick_random_unweighted(Distribution* distribution, BitField field, RandomStream* random) {
+	int word_count = bit_field_word_size(distribution->tile_field_size);
 	int tile_count = 0;
 
-	for (int i = 0; i < set.length; i++) {
-		Distribution* distribution = set.distributions[i];
+	for (int i = 0; i < word_count; i++) {
+		tile_count += __builtin_popcountll(field_get_word(field, distribution->tile_field_size, i));
+	}
 
-		for (int j = 0;;) {
-			int tile = field_get_rightmost_bit(field, distribution->tile_field_size, j);
-			if (tile == NO_MORE_BITS) break;
+	int roll = random_below(random, tile_count);
 
-			tile_count++;
-			j = tile + 1;
-		}
+	for (int i = 0; i < word_count; i++) {
+		uint64_t word = field_get_word(field, distribution->tile_field_size, i);
+		int word_tile_count = __builtin_popcountll(word);
+
+		if (roll < word_tile_count) return i * 64 + word_select_bit(word, roll);
+		roll -= word_tile_count;
 	}
 
-	int roll = rand() % tile_count;
-	tile_count = 0;
+	fprintf(stderr, "Failed to select tile in distribution_pick_random_unweighted()\n");
+	exit(1);
+}
 
-	for (int i = 0; i < set.length; i++) {
-		Distribution* distribution = set.distributions[i];
+// sum of the weights in a word of a field, only bytes with tiles in them are looked up
+Entropy get_word_weight(Distribution* distribution, uint64_t word, int word_index) {
+	Entropy weight = 0;
 
-		for (int j = 0;;) {
-			int tile = field_get_rightmost_bit(field, distribution->tile_field_size, j);
-			if (tile == NO_MORE_BITS) break;
+	while (word != 0) {
+		int shift = __builtin_ctzll(word) & ~7;
+		weight += distribution->tables[word_index * 8 + (shift >> 3)]->sums[(word >> shift) & 0xFF][0];
+		word &= ~((uint64_t)0xFF << shift);
+	}
+
+	return weight;
+}
 
-			tile_count++;
-			if (tile_count > roll) return tile;
-			j = tile + 1;
+// the roll has to be less than the word's weight
+int distribution_pick_random_from_weighted_word(Distribution* distribution, uint64_t word, int word_index, Entropy roll) {
+	while (word != 0) {
+		int shift = __builtin_ctzll(word) & ~7;
+		int byte = word_index * 8 + (shift >> 3);
+		uint32_t bits = (word >> shift) & 0xFF;
+		word &= ~((uint64_t)0xFF << shift);
+
+		Entropy byte_weight = distribution->tables[byte]->sums[bits][0];
+		if (roll >= byte_weight) {
+			roll -= byte_weight;
+			continue;
+		}
+
+		for (; bits != 0; bits &= bits - 1) {
+			int tile = byte * 8 + __builtin_ctz(bits);
+			roll -= distribution->weights[tile];
+			if (roll < 0) return tile;
 		}
 	}
 
-	fprintf(stderr, "Failed to select tile in distribution_pick_random_unweighted()\n");
+	fprintf(stderr, "Failed to select tile in distribution_pick_random_from_weighted_word()\n");
 	exit(1);
 }
 
-int distribution_pick_random_from_weighted_byte(Distribution* distribution, BitField field, int byte) {
-	Entropy byte_weight = distribution->weight_table[byte * 256 + field_get_byte(field, byte)];
-	Entropy roll = rand() % byte_weight;
+int distribution_pick_random_from_alias_table(Distribution* distribution, RandomStream* random) {
+	int slot = random_below(random, distribution->alias_length);
+	Entropy roll = random_below(random, distribution->alias_weight_sum);
+
+	return roll < distribution->alias_thresholds[slot] ? distribution->alias_tiles[slot] : distribution->alias_others[slot];
+}
+
+// build the alias table used while a field still holds every tile of the distribution, returns the bytes it allocated
+// every slot holds its own tile and one other, tile weights are scaled by the slot count so the table is exact
+int distribution_build_alias_table(Distribution* distribution) {
+	if (distribution->alias_length != ALIAS_TABLE_STALE) return 0;
+
+	int tile_count = field_popcnt(distribution->all_tiles, distribution->tile_field_size);
 	Entropy weight_sum = 0;
 
-	for (int i = byte * 8;;) {
-		int tile = field_get_rightmost_bit(field, distribution->tile_field_size, i);
-		if (tile == NO_MORE_BITS || tile >= byte * 8 + 8) break;
-		i = tile + 1;
+	for (int tile = 0; tile < distribution->tile_field_size * 8; tile++) {
+		if (field_get_bit(distribution->all_tiles, tile)) weight_sum += distribution->weights[tile];
+	}
 
-		weight_sum += distribution->weights[tile];
-		if (weight_sum > roll) return tile;
+	if (tile_count == 0 || weight_sum <= 0) {
+		distribution->alias_length = 0;
+		return 0;
 	}
 
-	exit(1);
-}
+	distribution->alias_tiles = realloc_inst(distribution->alias_tiles, tile_count * sizeof(int));
+	distribution->alias_others = realloc_inst(distribution->alias_others, tile_count * sizeof(int));
+	distribution->alias_thresholds = realloc_inst(distribution->alias_thresholds, tile_count * sizeof(Entropy));
+	int64_t* scaled_weights = malloc_inst(tile_count * sizeof(int64_t));
+	int* slots = malloc_inst(tile_count * sizeof(int));	 // under filled slots from the front, over filled from the back
 
-void distribution_area_get_all_tiles(BitField field, int field_size) {
-	field_clear(field, field_size);
-	for (int i = 0; i < set.length; i++) {
-		Distribution* distribution = set.distributions[i];
-		if (field_size < distribution->tile_field_size) {
-			field_or(field, distribution->all_tiles, field_size);
+	if (distribution->alias_tiles == NULL || distribution->alias_others == NULL || distribution->alias_thresholds == NULL || scaled_weights == NULL || slots == NULL) {
+		fprintf(stderr, "Failed to allocate memory: distribution_build_alias_table()\n");
+		exit(1);
+	}
+
+	int under_count = 0, over_start = tile_count;
+
+	for (int tile = 0, slot = 0; tile < distribution->tile_field_size * 8; tile++) {
+		if (!field_get_bit(distribution->all_tiles, tile)) continue;
+
+		distribution->alias_tiles[slot] = tile;
+		scaled_weights[slot] = (int64_t)distribution->weights[tile] * tile_count;
+
+		if (scaled_weights[slot] < weight_sum) {
+			slots[under_count++] = slot;
 		} else {
-			field_or(field, distribution->all_tiles, distribution->tile_field_size);
+			slots[--over_start] = slot;
+		}
+
+		slot++;
+	}
+
+	// top up under filled slots from over filled ones
+	while (under_count > 0 && over_start < tile_count) {
+		int under = slots[--under_count];
+		int over = slots[over_start];
+
+		distribution->alias_thresholds[under] = scaled_weights[under];
+		distribution->alias_others[under] = distribution->alias_tiles[over];
+		scaled_weights[over] -= weight_sum - scaled_weights[under];
+
+		if (scaled_weights[over] < weight_sum) {
+			over_start++;
+			slots[under_count++] = over;
 		}
 	}
+
+	// whatever's left is exactly full
+	for (int i = 0; i < under_count; i++) {
+		distribution->alias_thresholds[slots[i]] = weight_sum;
+		distribution->alias_others[slots[i]] = distribution->alias_tiles[slots[i]];
+	}
+
+	for (int i = over_start; i < tile_count; i++) {
+		distribution->alias_thresholds[slots[i]] = weight_sum;
+		distribution->alias_others[slots[i]] = distribution->alias_tiles[slots[i]];
+	}
+
+	free_inst(scaled_weights);
+	free_inst(slots);
+
+	distribution->alias_length = tile_count;
+	distribution->alias_weight_sum = weight_sum;
+
+	return tile_count * (sizeof(int) * 2 + sizeof(Entropy));
+}
+
+void distribution_selection_get_all_tiles(DistributionSelection* set, BitField field, int field_size) {
+	Distribution* distribution = set->distribution;
+
+	field_clear(field, field_size);
+	if (field_size < distribution->tile_field_size) {
+		field_or(field, distribution->all_tiles, field_size);
+	} else {
+		field_or(field, distribution->all_tiles, distribution->tile_field_size);
+	}
 }
 
-Entropy distribution_area_get_shannon_entropy(BitField field) {
-	Entropy weight_sum = 0, weight_log_weight_sum = 0;
+// lanes set for each tile in a byte, the low 4 tiles then the high 4
+v128_t byte_lane_masks[256][2];
+int byte_lane_masks_ready = 0;
 
-	for (int i = 0; i < set.length; i++) {
-		Distribution* distribution = set.distributions[i];
+void initalize_byte_lane_masks() {
+	for (int bits = 0; bits < 256; bits++) {
+		byte_lane_masks[bits][0] = wasm_i32x4_make(-(bits & 1), -((bits >> 1) & 1), -((bits >> 2) & 1), -((bits >> 3) & 1));
+		byte_lane_masks[bits][1] = wasm_i32x4_make(-((bits >> 4) & 1), -((bits >> 5) & 1), -((bits >> 6) & 1), -((bits >> 7) & 1));
+	}
+
+	byte_lane_masks_ready = 1;
+}
+
+// sums straight from the tile bits, each byte of the field is spread over 8 lanes that mask the weights of its tiles
+// this reads 64 bytes of weights for each byte instead of an entry in a 2KB table, so it wins once the tables no longer fit in cache
+void get_weight_sums_simd(Distribution* distribution, BitField field, Entropy* weight_sum, Entropy* weight_log_weight_sum) {
+	v128_t weight_sums = wasm_i32x4_splat(0), weight_log_weight_sums = wasm_i32x4_splat(0);
+
+	for (int frame = 0; frame < bit_field_storage_frame_size(distribution->tile_field_size); frame++) {
+		if (!wasm_v128_any_true(wasm_v128_load(field + frame))) continue;
+
+		for (int byte = frame * BIT_FIELD_FRAME_SIZE; byte < (frame + 1) * BIT_FIELD_FRAME_SIZE && byte < distribution->tile_field_size; byte++) {
+			uint8_t bits = field_get_byte(field, byte);
+			if (bits == 0) continue;
 
-		for (int j = 0; j < distribution->tile_field_size; j++) {
-			int index = j * 256 + field_get_byte(field, j);
-			weight_sum += distribution->weight_table[index];
-			weight_log_weight_sum += distribution->weight_log_weight_table[index];
+			v128_t low_mask = byte_lane_masks[bits][0], high_mask = byte_lane_masks[bits][1];
+			Entropy* weights = distribution->weights + byte * 8;
+			Entropy* weight_log_weights = distribution->weight_log_weights + byte * 8;
+
+			weight_sums = wasm_i32x4_add(weight_sums, wasm_v128_and(wasm_v128_load(weights), low_mask));
+			weight_sums = wasm_i32x4_add(weight_sums, wasm_v128_and(wasm_v128_load(weights + 4), high_mask));
+			weight_log_weight_sums = wasm_i32x4_add(weight_log_weight_sums, wasm_v128_and(wasm_v128_load(weight_log_weights), low_mask));
+			weight_log_weight_sums = wasm_i32x4_add(weight_log_weight_sums, wasm_v128_and(wasm_v128_load(weight_log_weights + 4), high_mask));
 		}
 	}
 
-	if (weight_sum == 0) return 0;
+	weight_sums = wasm_i32x4_add(weight_sums, wasm_i32x4_shuffle(weight_sums, weight_sums, 2, 3, 0, 1));
+	weight_sums = wasm_i32x4_add(weight_sums, wasm_i32x4_shuffle(weight_sums, weight_sums, 1, 0, 3, 2));
+	weight_log_weight_sums = wasm_i32x4_add(weight_log_weight_sums, wasm_i32x4_shuffle(weight_log_weight_sums, weight_log_weight_sums, 2, 3, 0, 1));
+	weight_log_weight_sums = wasm_i32x4_add(weight_log_weight_sums, wasm_i32x4_shuffle(weight_log_weight_sums, weight_log_weight_sums, 1, 0, 3, 2));
+
+	*weight_sum = wasm_i32x4_extract_lane(weight_sums, 0);
+	*weight_log_weight_sum = wasm_i32x4_extract_lane(weight_log_weight_sums, 0);
+}
+
+// sums of weight and weight * log weight over every tile in a field, the entropy of the field follows from these
+void distribution_selection_get_weight_sums(DistributionSelection* set, BitField field, Entropy* weight_sum, Entropy* weight_log_weight_sum) {
+	Distribution* distribution = set->distribution;
+
+	if (set->area->use_simd_sums) {
+		get_weight_sums_simd(distribution, field, weight_sum, weight_log_weight_sum);
+		return;
+	}
+
+	*weight_sum = 0;
+	*weight_log_weight_sum = 0;
+
+	for (int j = 0; j < distribution->tile_field_size; j++) {
+		Entropy* sums = distribution->tables[j]->sums[field_get_byte(field, j)];
+		*weight_sum += sums[0];
+		*weight_log_weight_sum += sums[1];
+	}
+}
+
+// what one tile adds to the weight sums
+void distribution_selection_get_tile_weights(DistributionSelection* set, int tile, Entropy* weight, Entropy* weight_log_weight) {
+	Distribution* distribution = set->distribution;
+
+	if (tile >= distribution->tile_field_size * 8) {
+		*weight = 0;
+		*weight_log_weight = 0;
+	} else {
+		*weight = distribution->weights[tile];
+		*weight_log_weight = distribution->weight_log_weights[tile];
+	}
+}
 
-	int log_weight_sum = (int)(logf(weight_sum) * ENTROPY_ONE_POINT);
+// log_weight_sum is the fixed point log of weight_sum
+Entropy distribution_get_shannon_entropy_from_sums(Entropy weight_sum, Entropy weight_log_weight_sum, Entropy log_weight_sum) {
+	if (weight_sum == 0) return 0;
 	return log_weight_sum - (weight_log_weight_sum / weight_sum);
 }
 
-int distribution_area_pick_random(BitField field) {
+int distribution_selection_pick_random(DistributionSelection* set, BitField field, RandomStream* random) {
+	Distribution* distribution = set->distribution;
+
+	// nothing has been ruled out yet
+	if (distribution->alias_length > 0 && memcmp(field, distribution->all_tiles, distribution->tile_field_size) == 0)
+		return distribution_pick_random_from_alias_table(distribution, random);
+
+	int word_count = bit_field_word_size(distribution->tile_field_size);
 	Entropy weight_sum = 0;
 
-	for (int i = 0; i < set.length; i++) {
-		Distribution* distribution = set.distributions[i];
+	for (int i = 0; i < word_count; i++) {
+		uint64_t word = field_get_word(field, distribution->tile_field_size, i);
+		if (word != 0) weight_sum += get_word_weight(distribution, word, i);
+	}
+
+	if (weight_sum == 0)
+		return distribution_pick_random_unweighted(distribution, field, random);
 
-		for (int j = 0; j < distribution->tile_field_size; j++) {
-			weight_sum += distribution->weight_table[j * 256 + field_get_byte(field, j)];
+	Entropy roll = random_below(random, weight_sum);
+
+	for (int i = 0; i < word_count; i++) {
+		uint64_t word = field_get_word(field, distribution->tile_field_size, i);
+		if (word == 0) continue;
+
+		Entropy word_weight = get_word_weight(distribution, word, i);
+		if (roll < word_weight) return distribution_pick_random_from_weighted_word(distribution, word, i, roll);
+		roll -= word_weight;
+	}
+
+	fprintf(stderr, "Failed to select tile in distribution_selection_pick_random()\n");
+	exit(1);
+}
+
+// forget the cached selection, needed when the distributions in an area are changed
+void distribution_selection_clear(DistributionSelection* set) {
+	set->area = NULL;
+	set->distribution = NULL;
+}
+
+// index of the cell starting at start_u, start_v, cells are one or two distributions wide and high
+int get_cell_index(DistributionArea* area, int start_u, int end_u, int start_v, int end_v) {
+	return (((start_v * 2 + (end_v - start_v - 1)) * area->distributions_width + start_u) << 1) + (end_u - start_u - 1);
+}
+
+int compare_distributions(const void* a, const void* b) {
+	Distribution* distribution_a = *(Distribution* const*)a;
+	Distribution* distribution_b = *(Distribution* const*)b;
+
+	return (distribution_a > distribution_b) - (distribution_a < distribution_b);
+}
+
+// bytes held by a distribution created with tile_field_size, its weight tables are held by the pool
+int get_distribution_size(int tile_field_size) {
+	return sizeof(Distribution) + tile_field_size * sizeof(WeightTable*) + tile_field_size * 8 * 2 * sizeof(Entropy) + bit_field_storage_frame_size(tile_field_size) * sizeof(BitFieldFrame);
+}
+
+// add distributions together, the sums of a merge are the sums of its sources so nothing blended changes
+Distribution* merge_distributions(DistributionArea* area, Distribution** sources, int length) {
+	if (length == 1) return sources[0];
+
+	Distribution* distributions[4];
+	memcpy(distributions, sources, length * sizeof(Distribution*));
+	qsort(distributions, length, sizeof(Distribution*), compare_distributions);
+
+	// only a few distinct merges turn up in an area so they're just searched
+	for (int i = 0; i < area->merge_count; i++) {
+		DistributionMerge* merge = &area->merges[i];
+		if (merge->length == length && memcmp(merge->sources, distributions, length * sizeof(Distribution*)) == 0) return merge->merged;
+	}
+
+	int tile_field_size = 0;
+	for (int i = 0; i < length; i++) {
+		if (distributions[i]->tile_field_size > tile_field_size) tile_field_size = distributions[i]->tile_field_size;
+	}
+
+	Distribution* merged = distribution_create(tile_field_size);
+
+	for (int i = 0; i < length; i++) {
+		Distribution* distribution = distributions[i];
+
+		for (int tile = 0; tile < distribution->tile_field_size * 8; tile++) {
+			merged->weights[tile] += distribution->weights[tile];
+			merged->weight_log_weights[tile] += distribution->weight_log_weights[tile];
 		}
+
+		field_or(merged->all_tiles, distribution->all_tiles, distribution->tile_field_size);
 	}
 
-	if (weight_sum == 0)
-		return distribution_pick_random_unweighted(field);
+	for (int i = 0; i < tile_field_size; i++) {
+		update_weight_table(merged, i);
+	}
+
+	area->merges = realloc_inst(area->merges, (area->merge_count + 1) * sizeof(DistributionMerge));
+
+	if (area->merges == NULL) {
+		fprintf(stderr, "Failed to allocate memory: merge_distributions()\n");
+		exit(1);
+	}
+
+	DistributionMerge* merge = &area->merges[area->merge_count++];
+	memcpy(merge->sources, distributions, length * sizeof(Distribution*));
+	merge->length = length;
+	merge->merged = merged;
 
-	Entropy roll = rand() % weight_sum;
-	weight_sum = 0;
+	area->cache_size += sizeof(DistributionMerge) + get_distribution_size(tile_field_size) + distribution_build_alias_table(merged);
 
-	for (int i = 0; i < set.length; i++) {
-		Distribution* distribution = set.distributions[i];
+	return merged;
+}
 
-		for (int j = 0; j < distribution->tile_field_size; j++) {
-			weight_sum += distribution->weight_table[j * 256 + field_get_byte(field, j)];
+// merge the distributions blended in every cell of the area, so a tile only has one distribution to look at
+// selecting from an area builds its cache when it's missing, areas shared between threads need it built first
+// the cache has to be cleared if the area is refilled or tiles are added to its distributions
+void distribution_area_build_cache(DistributionArea* area) {
+	if (area->cell_distributions != NULL) return;
 
-			if (weight_sum > roll)
-				return distribution_pick_random_from_weighted_byte(distribution, field, j);
+	int width = area->distributions_width;
+	area->cell_distributions = malloc_inst(width * width * 4 * sizeof(Distribution*));
+
+	if (area->cell_distributions == NULL) {
+		fprintf(stderr, "Failed to allocate memory: distribution_area_build_cache()\n");
+		exit(1);
+	}
+
+	area->cache_size += width * width * 4 * sizeof(Distribution*);
+
+	for (int start_v = 0; start_v < width; start_v++) {
+		for (int start_u = 0; start_u < width; start_u++) {
+			for (int cell = 0; cell < 4; cell++) {
+				int end_u = start_u + 1 + (cell & 1), end_v = start_v + 1 + (cell >> 1);
+
+				// cells on the far edges only blend what's in the area
+				Distribution* sources[4];
+				int length = 0;
+
+				for (int u = start_u; u < end_u && u < width; u++) {
+					for (int v = start_v; v < end_v && v < width; v++) {
+						sources[length++] = area->distributions[u + v * width];
+					}
+				}
+
+				Distribution* distribution = merge_distributions(area, sources, length);
+				area->cell_distributions[get_cell_index(area, start_u, end_u, start_v, end_v)] = distribution;
+
+				// merges already have theirs, cells of one distribution give it a table that isn't part of the cache
+				distribution_build_alias_table(distribution);
+			}
 		}
 	}
 
-	fprintf(stderr, "Failed to select tile in distribution_pick_random()\n");
-	exit(1);
+	// the tables are quicker while they fit in cache, what matters is how many there are in all and not how big one field is
+	area->use_simd_sums = weight_table_pool_size >= SIMD_SUMS_MIN_TABLE_POOL_SIZE;
 }
 
-void distribution_area_select(DistributionArea* area, int x, int y) {
+// select the distributions blended together at x, y, tiles next to each other usually share them so
+// the last selection is kept until x, y falls in a different cell
+void distribution_area_select(DistributionSelection* set, DistributionArea* area, int x, int y) {
 	int start_u = (x * 4 / area->distribution_size + 1) / 4;
 	int end_u = (x * 4 / area->distribution_size + 7) / 4;
 	int start_v = (y * 4 / area->distribution_size + 1) / 4;
 	int end_v = (y * 4 / area->distribution_size + 7) / 4;
 
-	set.length = 0;
+	if (set->area == area && set->start_u == start_u && set->end_u == end_u && set->start_v == start_v && set->end_v == end_v) return;
 
-	for (int u = start_u; u < end_u; u++) {
-		for (int v = start_v; v < end_v; v++) {
-			Distribution* distribution = area->distributions[u + v * area->distributions_width];
-			set.distributions[set.length] = distribution;
-			set.length++;
-		}
-	}
+	set->area = area;
+	set->start_u = start_u;
+	set->end_u = end_u;
+	set->start_v = start_v;
+	set->end_v = end_v;
+
+	distribution_area_build_cache(area);
+	set->distribution = area->cell_distributions[get_cell_index(area, start_u, end_u, start_v, end_v)];
 }
 
 void distribution_add_tile(Distribution* distribution, int tile, Entropy weight) {
 	distribution->weights[tile] = weight;
+	distribution->weight_log_weights[tile] = weight * (int)(logf(weight) * ENTROPY_ONE_POINT);
+	update_weight_table(distribution, tile / 8);
 
-	int tile_byte_index = tile / 8;
-	int tile_bit_index = tile % 8;
-
-	Entropy* weight_table = distribution->weight_table + tile_byte_index * 256;
-	Entropy* weight_log_weight_table = distribution->weight_log_weight_table + tile_byte_index * 256;
+	field_set_bit(distribution->all_tiles, tile);
+	distribution->alias_length = ALIAS_TABLE_STALE;
+}
 
-	Entropy weight_log_weight = weight * (int)(logf(weight) * ENTROPY_ONE_POINT);
+// replace every tile at once, the weights are copied so they can come from anywhere
+void distribution_set_weights(Distribution* distribution, Entropy* weights, Entropy* weight_log_weights, BitField all_tiles) {
+	memcpy(distribution->weights, weights, distribution->tile_field_size * 8 * sizeof(Entropy));
+	memcpy(distribution->weight_log_weights, weight_log_weights, distribution->tile_field_size * 8 * sizeof(Entropy));
+	field_copy(distribution->all_tiles, all_tiles, distribution->tile_field_size);
 
-	// iterate though all byte values with tile_bit_index set
-	for (int i = 0; i < 256; i += (2 << tile_bit_index)) {
-		for (int j = 0; j < (1 << tile_bit_index); j++) {
-			int byte = (1 << tile_bit_index) + i + j;
-			weight_table[byte] += weight;
-			weight_log_weight_table[byte] += weight_log_weight;
-		}
+	for (int i = 0; i < distribution->tile_field_size; i++) {
+		update_weight_table(distribution, i);
 	}
 
-	field_set_bit(distribution->all_tiles, tile);
+	distribution->alias_length = ALIAS_TABLE_STALE;
 }
 
 DistributionArea* distribution_area_create(Distribution** distributions, int distribution_size, int distributions_width) {
@@ -184,6 +571,12 @@ DistributionArea* distribution_area_create(Distribution** distributions, int dis
 	area->distribution_size = distribution_size;
 	area->distributions_width = distributions_width;
 
+	area->cell_distributions = NULL;
+	area->merges = NULL;
+	area->merge_count = 0;
+	area->cache_size = 0;
+	area->use_simd_sums = 0;
+
 	return area;
 }
 
@@ -195,17 +588,29 @@ Distribution* distribution_create(int tile_field_size) {
 		exit(1);
 	}
 
-	distribution->weights = calloc_inst(tile_field_size * 256, sizeof(Entropy));
-	distribution->weight_table = calloc_inst(tile_field_size * 256, sizeof(Entropy));
-	distribution->weight_log_weight_table = calloc_inst(tile_field_size * 256, sizeof(Entropy));
-	distribution->all_tiles = calloc_inst(1, tile_field_size);
+	distribution->weights = calloc_inst(tile_field_size * 8, sizeof(Entropy));
+	distribution->weight_log_weights = calloc_inst(tile_field_size * 8, sizeof(Entropy));
+	distribution->tables = malloc_inst(tile_field_size * sizeof(WeightTable*));
+	distribution->all_tiles = field_create(tile_field_size);
 
-	if (distribution->weights == NULL || distribution->weight_table == NULL || distribution->weight_log_weight_table == NULL || distribution->all_tiles == NULL) {
+	if (distribution->weights == NULL || distribution->weight_log_weights == NULL || distribution->tables == NULL || distribution->all_tiles == NULL) {
 		fprintf(stderr, "Failed to allocate memory: distribution_create()\n");
 		exit(1);
 	}
 
 	distribution->tile_field_size = tile_field_size;
+	if (!byte_lane_masks_ready) initalize_byte_lane_masks();
+
+	// every distribution starts out sharing the empty table
+	for (int i = 0; i < tile_field_size; i++) {
+		distribution->tables[i] = acquire_weight_table(distribution->weights + i * 8, distribution->weight_log_weights + i * 8);
+	}
+
+	distribution->alias_length = ALIAS_TABLE_STALE;
+	distribution->alias_tiles = NULL;
+	distribution->alias_others = NULL;
+	distribution->alias_thresholds = NULL;
+	distribution->alias_weight_sum = 0;
 
 	return distribution;
 }
\ No newline at end of file
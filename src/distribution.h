@@ -1,42 +1,101 @@
 #ifndef DISTRIBUTION_GUARD
 #define DISTRIBUTION_GUARD
 
-#include <emscripten.h>
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "bitfield.h"
+#include "hashmap.h"
 #include "meminst.h"
+#include "platform.h"
+#include "random.h"
 
 // entropy is calculated with fixed point math, this is the integer value representing one
 #define ENTROPY_ONE_POINT 1000
+#define ALIAS_TABLE_STALE -1
+#define SIMD_SUMS_MIN_TABLE_POOL_SIZE (8 << 20)  // areas built once the weight tables take this many bytes sum by masking tile weights, see bench/distribution.c
 
 typedef int Entropy;
+
+// sums of weight and weight * log weight for every value of one byte of a field
+// a table only depends on the weights of its 8 tiles, so distributions agreeing on them share it
+typedef struct WeightTable {
+	Entropy sums[256][2];  // weight then weight * log weight, they're always read together
+	Entropy weights[8];
+	Entropy weight_log_weights[8];
+	int reference_count;
+	uint64_t key;
+	struct WeightTable* next;  // next table in the pool with the same key
+} WeightTable;
+
 typedef struct {
 	Entropy* weights;
-	Entropy* weight_table;
-	Entropy* weight_log_weight_table;
+	WeightTable** tables;  // one for each byte of a field
 	BitField all_tiles;
 	int tile_field_size;
+	Entropy* weight_log_weights;  // weight * log weight of each tile, the weight tables are sums of these
+
+	// alias table for picking from fields that still hold every tile, see distribution_build_alias_table
+	int alias_length;  // ALIAS_TABLE_STALE until it's built, 0 when there's nothing to pick
+	int* alias_tiles;
+	int* alias_others;
+	Entropy* alias_thresholds;	// a slot picks its own tile when a roll below alias_weight_sum is under this
+	Entropy alias_weight_sum;
 } Distribution;
 
 extern EMSCRIPTEN_KEEPALIVE Distribution* distribution_create(int tile_field_size);
 extern EMSCRIPTEN_KEEPALIVE void distribution_add_tile(Distribution* distribution, int tile, Entropy weight);
+void distribution_set_weights(Distribution* distribution, Entropy* weights, Entropy* weight_log_weights, BitField all_tiles);
 extern EMSCRIPTEN_KEEPALIVE void distribution_free(Distribution* distribution);
+int distribution_build_alias_table(Distribution* distribution);
+extern EMSCRIPTEN_KEEPALIVE int distribution_get_table_pool_size();
+
+// distributions added together, shared by every cell blending the same ones
+typedef struct {
+	Distribution* sources[4];  // sorted so the same distributions in any order share a merge
+	int length;
+	Distribution* merged;
+} DistributionMerge;
 
 typedef struct {
 	Distribution** distributions;
 	int distribution_size;	  // size of an individual distribution in tiles
 	int distributions_width;  // number of distributions wide
+
+	// merged distribution for each cell, see distribution_area_build_cache
+	Distribution** cell_distributions;
+	DistributionMerge* merges;
+	int merge_count;
+	int cache_size;	 // bytes held by the merges
+	int use_simd_sums;  // decided when the cache is built, see SIMD_SUMS_MIN_TABLE_POOL_SIZE
 } DistributionArea;
 
+// distributions blended together at one point of an area, each superposition keeps its own
+typedef struct {
+	Distribution* distribution;	 // merged from every distribution blended at the cell
+
+	// cell the distributions were selected from
+	DistributionArea* area;
+	int start_u;
+	int end_u;
+	int start_v;
+	int end_v;
+} DistributionSelection;
+
 extern EMSCRIPTEN_KEEPALIVE DistributionArea* distribution_area_create(Distribution** distributions, int distribution_size, int distributions_width);
+extern EMSCRIPTEN_KEEPALIVE void distribution_area_build_cache(DistributionArea* area);
+extern EMSCRIPTEN_KEEPALIVE void distribution_area_clear_cache(DistributionArea* area);
+extern EMSCRIPTEN_KEEPALIVE int distribution_area_get_cache_size(DistributionArea* area);
 void distribution_area_set_point(DistributionArea* area, Distribution* distribution, int x, int y);
-void distribution_area_select(DistributionArea* area, int x, int y);
-int distribution_area_pick_random(BitField field);
-Entropy distribution_area_get_shannon_entropy(BitField field);
-void distribution_area_get_all_tiles(BitField field, int field_size);
+void distribution_area_select(DistributionSelection* set, DistributionArea* area, int x, int y);
+void distribution_selection_clear(DistributionSelection* set);
+int distribution_selection_pick_random(DistributionSelection* set, BitField field, RandomStream* random);
+void distribution_selection_get_weight_sums(DistributionSelection* set, BitField field, Entropy* weight_sum, Entropy* weight_log_weight_sum);
+void distribution_selection_get_tile_weights(DistributionSelection* set, int tile, Entropy* weight, Entropy* weight_log_weight);
+Entropy distribution_get_shannon_entropy_from_sums(Entropy weight_sum, Entropy weight_log_weight_sum, Entropy log_weight_sum);
+void distribution_selection_get_all_tiles(DistributionSelection* set, BitField field, int field_size);
 extern EMSCRIPTEN_KEEPALIVE void distribution_area_free(DistributionArea* area);
 
 #endif
\ No newline at end of file
@@ -4,8 +4,11 @@ import { Tileset } from "./tileset";
 let distribution_create: (tile_field_size: number) => number;
 let distribution_add_tile: (distribution: number, tile: number, weight: number) => void;
 let distribution_free: (distribution: number) => void;
+let distribution_get_table_pool_size: () => number;
 
 let distribution_area_create: (distributions: number, distribution_size: number, distributions_width: number) => number;
+let distribution_area_clear_cache: (area: number) => void;
+let distribution_area_get_cache_size: (area: number) => number;
 let distribution_area_free: (area: number) => void;
 
 const distributionRegistry = new FinalizationRegistry((ptr: number) => {
@@ -20,11 +23,19 @@ export function init() {
     distribution_create = cwrap("distribution_create", "number", ["number"]);
     distribution_add_tile = cwrap("distribution_add_tile", null, ["number", "number", "number"]);
     distribution_free = cwrap("distribution_free", null, ["number"]);
+    distribution_get_table_pool_size = cwrap("distribution_get_table_pool_size", "number", []);
 
     distribution_area_create = cwrap("distribution_area_create", "number", ["number", "number", "number"]);
+    distribution_area_clear_cache = cwrap("distribution_area_clear_cache", null, ["number"]);
+    distribution_area_get_cache_size = cwrap("distribution_area_get_cache_size", "number", ["number"]);
     distribution_area_free = cwrap("distribution_area_free", null, ["number"]);
 }
 
+// bytes held by weight tables, they're shared by every distribution
+export function getTablePoolSize(): number {
+    return distribution_get_table_pool_size();
+}
+
 export class Distribution {
     readonly ptr: number;
     readonly tileset: Tileset;
@@ -35,6 +46,13 @@ export class Distribution {
         return distribution;
     }
 
+    // takes ownership of a distribution made in c, like one loaded from a file
+    static fromPtr(ptr: number, tileset: Tileset): Distribution {
+        const distribution = new Distribution(ptr, tileset);
+        distributionRegistry.register(distribution, distribution.ptr, distribution);
+        return distribution;
+    }
+
     constructor(ptr: number, tileset: Tileset) {
         this.ptr = ptr;
         this.tileset = tileset;
@@ -59,10 +77,10 @@ export class DistributionArea {
     readonly distributions: Distribution[]; // kept to stop premature deallocation
 
     static create(distributions: Distribution[], distributionSize: number, distributionsWidth: number): DistributionArea {
-        const distributionsPtr = mallocInst(distributions.length * 8);
+        const distributionsPtr = mallocInst(distributions.length * 4);
 
         for (let i = 0; i < distributions.length; i++) {
-            setValue(distributionsPtr + i * 8, distributions[i].ptr, "*");
+            setValue(distributionsPtr + i * 4, distributions[i].ptr, "*");
         }
 
         const area = new DistributionArea(distribution_area_create(distributionsPtr, distributionSize, distributionsWidth), distributions);
@@ -76,6 +94,16 @@ export class DistributionArea {
         this.distributions = distributions;
     }
 
+    // needed after adding tiles to any of the area's distributions
+    clearCache() {
+        distribution_area_clear_cache(this.ptr);
+    }
+
+    // bytes held by the merged distributions
+    get cacheSize(): number {
+        return distribution_area_get_cache_size(this.ptr);
+    }
+
     free() {
         distributionAreaRegistry.unregister(this);
         distribution_area_free(this.ptr);
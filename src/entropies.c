@@ -4,134 +4,216 @@
 // holds entropy data for Superposition
 // allow quick to:
 //   - update entropy by coordinate with a 2d array
-//   - to find minimum entropy with a heap
+//   - to find minimum entropy with a heap or buckets
 // these two data structures are updated in sync
 
+// the tile arrays belong to the arena they were allocated from
 void entropies_free(Entropies* entropies) {
-	free_inst(entropies->tiles);
-	free_inst(entropies->tile_nodes);
-
-	free_inst(entropies->keys);
-	free_inst(entropies->values);
-
+	free_inst(entropies->bucket_heads);
 	free_inst(entropies);
 }
 
-void entropies_heap_swim(Entropies* entropies, GenerationHeapNode node) {
-	GenerationTile key = entropies->keys[node];
-	Entropy value = entropies->values[node];
+// the heap has four children per node, a node's children are next to each other so they're compared within one cache line
+// nodes are packed so ties are broken by key, and the least tile doesn't depend on the order entropies were updated in
+#define entropies_first_child(node) ((node) * HEAP_ARITY + 1)
+#define entropies_parent(node) (((node) - 1) / HEAP_ARITY)
 
-	while (node > 1) {
-		GenerationHeapNode parent = node >> 1;
+void entropies_heap_place(Entropies* entropies, GenerationHeapNode node, EntropyNode entropy_node) {
+	entropies->nodes[node] = entropy_node;
+	entropies->tile_nodes[entropy_node_key(entropy_node)] = node;
+}
 
-		if (value >= entropies->values[parent]) break;
+void entropies_heap_swim(Entropies* entropies, GenerationHeapNode node) {
+	EntropyNode moving = entropies->nodes[node];
 
-		GenerationTile parent_key = entropies->keys[parent];
-		entropies->keys[node] = parent_key;
-		entropies->tile_nodes[parent_key] = node;
-		entropies->values[node] = entropies->values[parent];
+	while (node > 0) {
+		GenerationHeapNode parent = entropies_parent(node);
+		EntropyNode parent_node = entropies->nodes[parent];
+		if (parent_node < moving) break;
 
+		entropies_heap_place(entropies, node, parent_node);
 		node = parent;
 	}
 
-	entropies->keys[node] = key;
-	entropies->tile_nodes[key] = node;
-	entropies->values[node] = value;
+	entropies_heap_place(entropies, node, moving);
 }
 
+// slots past the end of the heap hold EMPTY_ENTROPY_NODE, so all four children can be compared without checking the size
 void entropies_heap_sink(Entropies* entropies, GenerationHeapNode node) {
-	GenerationTile key = entropies->keys[node];
-	Entropy value = entropies->values[node];
-	GenerationHeapNode half_size = entropies->heap_size >> 1;
+	EntropyNode* nodes = entropies->nodes;
+	EntropyNode moving = nodes[node];
 
-	while (node <= half_size) {
-		GenerationHeapNode left = node << 1;
-		GenerationHeapNode right = left + 1;
+	for (;;) {
+		GenerationHeapNode first = entropies_first_child(node);
+		if (first >= entropies->heap_size) break;
 
-		Entropy left_value = entropies->values[left];
+		GenerationHeapNode child = first;
+		EntropyNode least = nodes[first];
 
-		GenerationHeapNode child;
-		Entropy child_value;
-
-		if (right <= entropies->heap_size) {
-			Entropy right_value = entropies->values[right];
-
-			if (left_value < right_value) {
-				child = left;
-				child_value = left_value;
-			} else {
-				child = right;
-				child_value = right_value;
+		for (GenerationHeapNode sibling = first + 1; sibling < first + HEAP_ARITY; sibling++) {
+			if (nodes[sibling] < least) {
+				child = sibling;
+				least = nodes[sibling];
 			}
-		} else {
-			child = left;
-			child_value = left_value;
 		}
 
-		if (child_value >= value) break;
-
-		GenerationTile child_key = entropies->keys[child];
-		entropies->keys[node] = child_key;
-		entropies->tile_nodes[child_key] = node;
-		entropies->values[node] = child_value;
+		if (moving < least) break;
 
+		entropies_heap_place(entropies, node, least);
 		node = child;
 	}
 
-	entropies->keys[node] = key;
-	entropies->tile_nodes[key] = node;
-	entropies->values[node] = value;
+	entropies_heap_place(entropies, node, moving);
 }
 
 void entropies_heap_push(Entropies* entropies, GenerationTile key, Entropy value) {
-	entropies->heap_size++;
-
-	entropies->keys[entropies->heap_size] = key;
+	entropies->nodes[entropies->heap_size] = entropy_node_pack(value, key);
 	entropies->tile_nodes[key] = entropies->heap_size;
-	entropies->values[entropies->heap_size] = value;
+	entropies->heap_size++;
 
-	entropies_heap_swim(entropies, entropies->heap_size);
+	entropies_heap_swim(entropies, entropies->heap_size - 1);
 }
 
-void entropies_heap_set(Entropies* entropies, GenerationHeapNode node, Entropy value) {
-	if (value > entropies->values[node]) {
-		entropies->values[node] = value;
+void entropies_heap_set(Entropies* entropies, GenerationHeapNode node, GenerationTile key, Entropy value) {
+	EntropyNode old_node = entropies->nodes[node];
+	entropies->nodes[node] = entropy_node_pack(value, key);
+
+	if (entropies->nodes[node] > old_node) {
 		entropies_heap_sink(entropies, node);
 	} else {
-		entropies->values[node] = value;
 		entropies_heap_swim(entropies, node);
 	}
 }
 
 void entropies_heapify(Entropies* entropies) {
-	for (GenerationHeapNode i = entropies->heap_size >> 1; i >= 1; i--) {
-		entropies_heap_sink(entropies, i);
+	if (entropies->heap_size < 2) return;
+
+	for (int node = entropies_parent(entropies->heap_size - 1); node >= 0; node--) {
+		entropies_heap_sink(entropies, node);
+	}
+}
+
+// entropies are whole numbers of thousandths, so each value gets its own bucket
+// rounding can take an entropy just below zero, those share the zero bucket
+Entropy entropies_bucket_of(Entropy value) {
+	return value < 0 ? 0 : value;
+}
+
+void entropies_bucket_push(Entropies* entropies, GenerationTile key, Entropy value) {
+	Entropy bucket = entropies_bucket_of(value);
+
+	// buckets only grow, so once the largest entropy of a tileset has been seen nothing more is allocated
+	if (bucket >= entropies->bucket_capacity) {
+		int capacity = entropies->bucket_capacity * 2 > bucket + 1 ? entropies->bucket_capacity * 2 : bucket + 1;
+		entropies->bucket_heads = realloc_inst(entropies->bucket_heads, capacity * sizeof(GenerationTile));
+
+		if (entropies->bucket_heads == NULL) {
+			fprintf(stderr, "Failed to allocate memory: entropies_bucket_push()\n");
+			exit(1);
+		}
+
+		for (int i = entropies->bucket_capacity; i < capacity; i++) {
+			entropies->bucket_heads[i] = NO_BUCKET_TILE;
+		}
+
+		entropies->bucket_capacity = capacity;
+	}
+
+	GenerationTile head = entropies->bucket_heads[bucket];
+	entropies->bucket_next[key] = head;
+	entropies->bucket_prev[key] = NO_BUCKET_TILE;
+	if (head != NO_BUCKET_TILE) entropies->bucket_prev[head] = key;
+	entropies->bucket_heads[bucket] = key;
+
+	if (bucket < entropies->bucket_min) entropies->bucket_min = bucket;
+	entropies->heap_size++;
+}
+
+void entropies_bucket_remove(Entropies* entropies, GenerationTile key, Entropy value) {
+	GenerationTile next = entropies->bucket_next[key], prev = entropies->bucket_prev[key];
+
+	if (prev == NO_BUCKET_TILE) {
+		entropies->bucket_heads[entropies_bucket_of(value)] = next;
+	} else {
+		entropies->bucket_next[prev] = next;
 	}
+
+	if (next != NO_BUCKET_TILE) entropies->bucket_prev[next] = prev;
+	entropies->heap_size--;
+}
+
+// the minimum only moves down when a tile is pushed below it, so finding the next full bucket is amortized O(1)
+GenerationTile entropies_bucket_collapse_least(Entropies* entropies) {
+	while (entropies->bucket_heads[entropies->bucket_min] == NO_BUCKET_TILE) {
+		entropies->bucket_min++;
+	}
+
+	GenerationTile key = entropies->bucket_heads[entropies->bucket_min];
+	entropies_bucket_remove(entropies, key, entropies->tiles[key]);
+	entropies->tiles[key] = COLLAPSED_ENTROPY;
+
+	return key;
 }
 
 void entropies_update_entropy(Entropies* entropies, GenerationTile key, Entropy value) {
 	int wasCollapsed = entropies->tiles[key] == COLLAPSED_ENTROPY;
 
+	if (entropies->queue == ENTROPY_QUEUE_BUCKETS) {
+		if (!wasCollapsed) entropies_bucket_remove(entropies, key, entropies->tiles[key]);
+		entropies->tiles[key] = value;
+		entropies_bucket_push(entropies, key, value);
+		return;
+	}
+
 	entropies->tiles[key] = value;
 	if (wasCollapsed) {
 		entropies_heap_push(entropies, key, value);
 	} else {
-		entropies_heap_set(entropies, entropies->tile_nodes[key], value);
+		entropies_heap_set(entropies, entropies->tile_nodes[key], key, value);
+	}
+}
+
+// start changing count entropies at once, like after a propagation wave
+// when the batch is a large part of the heap its changes are written in place and the heap is rebuilt once by entropies_end_batch
+// smaller batches are cheaper to sift one change at a time
+void entropies_begin_batch(Entropies* entropies, int count) {
+	entropies->batch_deferred = entropies->queue == ENTROPY_QUEUE_HEAP && count * HEAP_BATCH_RATIO > (int)entropies->heap_size;
+}
+
+void entropies_set_entropy(Entropies* entropies, GenerationTile key, Entropy value) {
+	if (!entropies->batch_deferred) {
+		entropies_update_entropy(entropies, key, value);
+		return;
+	}
+
+	if (entropies->tiles[key] == COLLAPSED_ENTROPY) {
+		entropies->tile_nodes[key] = entropies->heap_size;
+		entropies->heap_size++;
 	}
+
+	entropies->tiles[key] = value;
+	entropies->nodes[entropies->tile_nodes[key]] = entropy_node_pack(value, key);
+}
+
+void entropies_end_batch(Entropies* entropies) {
+	if (entropies->batch_deferred) entropies_heapify(entropies);
+	entropies->batch_deferred = 0;
 }
 
 GenerationTile entropies_collapse_least(Entropies* entropies) {
-	GenerationTile key = entropies->keys[1];
+	if (entropies->queue == ENTROPY_QUEUE_BUCKETS) return entropies_bucket_collapse_least(entropies);
 
+	GenerationTile key = entropy_node_key(entropies->nodes[0]);
 	entropies->tiles[key] = COLLAPSED_ENTROPY;
 
-	GenerationTile last_key = entropies->keys[entropies->heap_size];
-	entropies->keys[1] = last_key;
-	entropies->tile_nodes[last_key] = 1;
-	entropies->values[1] = entropies->values[entropies->heap_size];
-
 	entropies->heap_size--;
-	entropies_heap_sink(entropies, 1);
+	EntropyNode last = entropies->nodes[entropies->heap_size];
+	entropies->nodes[entropies->heap_size] = EMPTY_ENTROPY_NODE;
+
+	if (entropies->heap_size > 0) {
+		entropies_heap_place(entropies, 0, last);
+		entropies_heap_sink(entropies, 0);
+	}
 
 	return key;
 }
@@ -140,46 +222,100 @@ int entropies_is_collapsed(Entropies* entropies, GenerationTile key) {
 	return entropies->tiles[key] == COLLAPSED_ENTROPY;
 }
 
-void entropies_initalize_from_tiles(Entropies* entropies, int width, int height) {
+// tile_count can be more than width * height when tiles aren't stored row by row, tiles past the area must be collapsed
+void entropies_initalize_from_tiles(Entropies* entropies, int width, int height, int tile_count) {
 	entropies->width = width;
 	entropies->height = height;
 
-	uint16_t size = width * height;
-	uint16_t node = 1;
-	for (uint16_t key = 0; key < size; key++) {
+	if (entropies->queue == ENTROPY_QUEUE_BUCKETS) {
+		for (int i = 0; i < entropies->bucket_capacity; i++) {
+			entropies->bucket_heads[i] = NO_BUCKET_TILE;
+		}
+
+		entropies->heap_size = 0;
+		entropies->bucket_min = entropies->bucket_capacity;
+
+		// pushed in reverse so ties start out going to the lowest tile
+		for (GenerationTile key = tile_count; key-- > 0;) {
+			if (entropies->tiles[key] != COLLAPSED_ENTROPY) entropies_bucket_push(entropies, key, entropies->tiles[key]);
+		}
+
+		return;
+	}
+
+	GenerationHeapNode node = 0;
+	for (GenerationTile key = 0; key < tile_count; key++) {
 		int entropy = entropies->tiles[key];
 		if (entropy == COLLAPSED_ENTROPY) continue;
 
-		entropies->keys[node] = key;
-		entropies->tile_nodes[key] = node;
-		entropies->values[node] = entropy;
+		entropies_heap_place(entropies, node, entropy_node_pack(entropy, key));
 		node++;
 	}
 
-	entropies->heap_size = node - 1;
+	entropies->heap_size = node;
+
+	for (; node < entropies->node_capacity; node++) {
+		entropies->nodes[node] = EMPTY_ENTROPY_NODE;
+	}
+
 	entropies_heapify(entropies);
 }
 
-Entropies* entropies_create(int maxWidth, int maxHeight) {
-	Entropies* entropies = malloc_inst(sizeof(Entropies));
+// a full heap still needs a group of empty children past its last node, and room to line the groups up with cache lines
+#define entropies_node_capacity(capacity) ((capacity) + HEAP_ARITY)
+#define entropies_nodes_size(capacity) ((entropies_node_capacity(capacity) + HEAP_ARITY) * sizeof(EntropyNode) + HEAP_ALIGNMENT)
 
-	if (entropies == NULL) {
-		fprintf(stderr, "Failed to allocate memory: entropies_create()\n");
-		exit(1);
-	}
+// bytes entropies_allocate takes from an arena
+size_t entropies_get_arena_size(int capacity) {
+	size_t tiles_size = arena_aligned_size(sizeof(Entropy) * capacity) + arena_aligned_size(sizeof(GenerationHeapNode) * capacity);
+	size_t buckets_size = arena_aligned_size(sizeof(GenerationTile) * capacity) * 2;
+	return tiles_size + arena_aligned_size(entropies_nodes_size(capacity)) + buckets_size;
+}
 
+// give the entropies room for capacity tiles, they stay valid until the arena is next reserved or reset
+void entropies_allocate(Entropies* entropies, Arena* arena, int capacity) {
 	// 2d array
-	entropies->tiles = malloc_inst(sizeof(Entropy) * maxWidth * maxHeight);
-	entropies->tile_nodes = malloc_inst(sizeof(GenerationHeapNode) * maxWidth * maxHeight);
+	entropies->tiles = arena_alloc(arena, sizeof(Entropy) * capacity);
+	entropies->tile_nodes = arena_alloc(arena, sizeof(GenerationHeapNode) * capacity);
+
+	// heap, children of a node start one after a multiple of four so each group of them starts on HEAP_ALIGNMENT
+	uintptr_t nodes = (uintptr_t)arena_alloc(arena, entropies_nodes_size(capacity));
+	nodes = (nodes + HEAP_ALIGNMENT - 1) / HEAP_ALIGNMENT * HEAP_ALIGNMENT;
+	entropies->nodes = (EntropyNode*)nodes + HEAP_ARITY - 1;
+	entropies->node_capacity = entropies_node_capacity(capacity);
+
+	// bucket links
+	entropies->bucket_next = arena_alloc(arena, sizeof(GenerationTile) * capacity);
+	entropies->bucket_prev = arena_alloc(arena, sizeof(GenerationTile) * capacity);
+
+	entropies->width = 0;
+	entropies->height = 0;
+	entropies->heap_size = 0;
+}
 
-	// heap
-	entropies->keys = malloc_inst(sizeof(GenerationTile) * maxWidth * maxHeight);
-	entropies->values = malloc_inst(sizeof(Entropy) * maxWidth * maxHeight);
+Entropies* entropies_create() {
+	Entropies* entropies = malloc_inst(sizeof(Entropies));
 
-	if (entropies->tiles == NULL || entropies->tile_nodes == NULL || entropies->keys == NULL || entropies->values == NULL) {
+	if (entropies == NULL) {
 		fprintf(stderr, "Failed to allocate memory: entropies_create()\n");
 		exit(1);
 	}
 
+	entropies->tiles = NULL;
+	entropies->tile_nodes = NULL;
+	entropies->nodes = NULL;
+	entropies->node_capacity = 0;
+	entropies->batch_deferred = 0;
+	entropies->width = 0;
+	entropies->height = 0;
+	entropies->heap_size = 0;
+
+	entropies->queue = ENTROPY_QUEUE_HEAP;
+	entropies->bucket_heads = NULL;
+	entropies->bucket_next = NULL;
+	entropies->bucket_prev = NULL;
+	entropies->bucket_capacity = 0;
+	entropies->bucket_min = 0;
+
 	return entropies;
-}
\ No newline at end of file
+}
@@ -5,36 +5,70 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "arena.h"
 #include "distribution.h"
 #include "meminst.h"
 
 typedef uint32_t GenerationHeapNode;
 typedef uint32_t GenerationTile;
 
+// entropy in the high half and tile in the low half, so nodes are ordered by entropy then tile with one comparison
+typedef int64_t EntropyNode;
+
+#define entropy_node_pack(value, key) ((EntropyNode)(value) * ((EntropyNode)1 << 32) + (key))
+#define entropy_node_key(node) ((GenerationTile)(node))
+#define EMPTY_ENTROPY_NODE INT64_MAX
+
+#define HEAP_ARITY 4
+#define HEAP_ALIGNMENT (HEAP_ARITY * sizeof(EntropyNode))
+#define HEAP_BATCH_RATIO 8	// batches changing more than an eighth of the heap rebuild it instead of sifting
+
+// how the least entropy tile is found
+typedef enum {
+	ENTROPY_QUEUE_HEAP,	   // 4-ary heap of packed nodes, O(log n) updates and batches rebuilt in O(n), ties go to the lowest tile
+	ENTROPY_QUEUE_BUCKETS  // one list of tiles per entropy value, O(1) updates, ties go to the last tile updated
+} EntropyQueue;
+
 typedef struct {
 	Entropy* tiles;
 	GenerationHeapNode* tile_nodes;
-	GenerationTile* keys;
-	Entropy* values;
+	EntropyNode* nodes;
 	int width;
 	int height;
-	GenerationHeapNode heap_size;
+	GenerationHeapNode heap_size;  // tiles waiting to be collapsed, in either queue
+	int node_capacity;
+	int batch_deferred;	 // heap is out of order until entropies_end_batch
+
+	EntropyQueue queue;
+
+	// bucket queue, a doubly linked list per entropy value
+	GenerationTile* bucket_heads;  // first tile with each entropy
+	GenerationTile* bucket_next;
+	GenerationTile* bucket_prev;
+	int bucket_capacity;
+	Entropy bucket_min;	 // no bucket below this has tiles
 } Entropies;
 
 #define COLLAPSED_ENTROPY -1
+#define NO_BUCKET_TILE 0xFFFFFFFF
 
 // ported from JS
 // holds entropy data for Superposition
 // allow quick to:
 //   - update entropy by coordinate with a 2d array
-//   - to find minimum entropy with a heap
+//   - to find minimum entropy with a heap or buckets
 // these two data structures are updated in sync
 
-Entropies* entropies_create(int maxWidth, int maxHeight);
-void entropies_initalize_from_tiles(Entropies* entropies, int width, int height);
+Entropies* entropies_create();
+size_t entropies_get_arena_size(int capacity);
+void entropies_allocate(Entropies* entropies, Arena* arena, int capacity);
+void entropies_initalize_from_tiles(Entropies* entropies, int width, int height, int tile_count);
 GenerationTile entropies_collapse_least(Entropies* entropies);
 int entropies_is_collapsed(Entropies* entropies, GenerationTile key);
 void entropies_update_entropy(Entropies* entropies, GenerationTile key, Entropy value);
+void entropies_begin_batch(Entropies* entropies, int count);
+void entropies_set_entropy(Entropies* entropies, GenerationTile key, Entropy value);
+void entropies_end_batch(Entropies* entropies);
 void entropies_free(Entropies* entropies);
 
 #endif
\ No newline at end of file
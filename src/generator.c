@@ -0,0 +1,91 @@
+#include "generator.h"
+
+// point the area at the source world tiles under a chunk, returns 0 if any of them aren't generated yet
+// window is reused between calls, the source chunks are looked up once for each call
+int fill_area_from_source(DistributionArea* area, World* source_world, ChunkWindow* window, Distribution** tile_distributions, int source_x, int source_y) {
+	world_select_chunk_window(source_world, window, source_x, source_y, area->distributions_width, area->distributions_width);
+
+	for (int v = 0; v < area->distributions_width; v++) {
+		for (int u = 0; u < area->distributions_width; u++) {
+			int tile_id = world_window_get(source_world, window, source_x + u, source_y + v);
+			if (tile_id == NULL_TILE) return 0;
+
+			area->distributions[u + v * area->distributions_width] = tile_distributions[tile_id];
+		}
+	}
+
+	return 1;
+}
+
+// create, initalize and fully collapse each chunk in chunk_coords, given as x, y pairs, returns how many were generated
+// without a source world the superposition's own distribution area is used, otherwise each chunk gets distributions
+// from the source world tiles under it, looked up by tile id in tile_distributions
+// the superposition and the area buffer are reused for every chunk in the batch
+int world_generate_chunks(World* world, int* chunk_coords, int chunk_count, Superposition* superposition, World* source_world, Distribution** tile_distributions, int distribution_size) {
+	int chunk_size = world->chunk_size;
+	DistributionArea* area = NULL;
+
+	if (source_world != NULL) {
+		if (chunk_size % distribution_size != 0) {
+			fprintf(stderr, "Chunks aren't aligned with source distribution tiles: world_generate_chunks()\n");
+			exit(1);
+		}
+
+		// tiles blend into the distribution after them, so the area reaches one source tile past the chunk
+		int distributions_width = chunk_size / distribution_size + 1;
+		Distribution** distributions = malloc_inst(distributions_width * distributions_width * sizeof(Distribution*));
+
+		if (distributions == NULL) {
+			fprintf(stderr, "Failed to allocate memory: world_generate_chunks()\n");
+			exit(1);
+		}
+
+		area = distribution_area_create(distributions, distribution_size, distributions_width);
+	}
+
+	int generated = 0;
+	ChunkWindow source_chunks;
+	chunk_window_init(&source_chunks);
+
+	for (int k = 0; k < chunk_count; k++) {
+		int x = chunk_coords[k * 2], y = chunk_coords[k * 2 + 1];
+
+		Chunk* chunk = world_get_chunk(world, x, y);
+		if (chunk == NULL) chunk = world_create_chunk(world, x, y);
+
+		if (area != NULL) {
+			if (!fill_area_from_source(area, source_world, &source_chunks, tile_distributions, x * chunk_size / distribution_size, y * chunk_size / distribution_size)) {
+				chunk_set_stage(chunk, CHUNK_FAILED);
+				continue;
+			}
+
+			// the merged distributions are for the last chunk's source tiles
+			distribution_area_clear_cache(area);
+
+			superposition_select_distribution_area(superposition, x * chunk_size, y * chunk_size, area);
+		}
+
+		chunk_set_stage(chunk, CHUNK_COLLAPSING);
+		superposition_select_collapse_area(superposition, x * chunk_size - superposition->x, y * chunk_size - superposition->y, chunk_size, chunk_size);
+
+		int result;
+		while ((result = superposition_collapse_tiles(superposition, chunk_size * chunk_size)) == COLLAPSE_UNFINISHED);
+
+		if (result == COLLAPSE_FAILED) {
+			chunk_set_stage(chunk, CHUNK_FAILED);
+		} else {
+			chunk_set_stage(chunk, CHUNK_GENERATED);
+			generated++;
+		}
+	}
+
+	if (area != NULL) {
+		// don't leave the superposition pointing at the freed area
+		distribution_area_free(area);
+		superposition->area = NULL;
+	}
+
+	chunk_window_free(&source_chunks);
+
+	return generated;
+}
@@ -0,0 +1,15 @@
+#ifndef GENERATOR_GUARD
+#define GENERATOR_GUARD
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "distribution.h"
+#include "meminst.h"
+#include "platform.h"
+#include "superposition.h"
+#include "world.h"
+
+extern EMSCRIPTEN_KEEPALIVE int world_generate_chunks(World* world, int* chunk_coords, int chunk_count, Superposition* superposition, World* source_world, Distribution** tile_distributions, int distribution_size);
+
+#endif
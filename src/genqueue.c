@@ -0,0 +1,189 @@
+#include "genqueue.h"
+
+void genqueue_free(GenerationQueue* queue) {
+	free_inst(queue->jobs);
+	free_inst(queue);
+}
+
+void genqueue_set_prefetch_radius(GenerationQueue* queue, int radius) {
+	queue->prefetch_radius = radius;
+}
+
+// sorts jobs so the most important one is last
+int compare_jobs(const void* a, const void* b) {
+	const GenerationJob* job_a = a;
+	const GenerationJob* job_b = b;
+
+	if (job_a->is_visible != job_b->is_visible) return job_a->is_visible - job_b->is_visible;
+	if (job_a->distance != job_b->distance) return job_a->distance < job_b->distance ? 1 : -1;
+	return 0;
+}
+
+void push_job(GenerationQueue* queue, GenerationJob job) {
+	if (queue->job_count == queue->job_capacity) {
+		queue->job_capacity *= 2;
+		queue->jobs = realloc_inst(queue->jobs, queue->job_capacity * sizeof(GenerationJob));
+
+		if (queue->jobs == NULL) {
+			fprintf(stderr, "Failed to allocate memory: push_job()\n");
+			exit(1);
+		}
+	}
+
+	queue->jobs[queue->job_count++] = job;
+}
+
+// rebuild the queue around the viewer, the view covers x - half_width to x + half_width in tiles
+// pending chunks that are no longer in range are cancelled and go back to being empty
+// nothing is rebuilt while the viewer stays over the same chunks heading the same way
+void genqueue_set_viewer(GenerationQueue* queue, double x, double y, double half_width, double half_height) {
+	World* world = queue->world;
+	int chunk_size = world->chunk_size;
+
+	// motion fades out over a few calls once the viewer stops, so the ring stays ahead of where it was going
+	if (queue->has_viewer) {
+		queue->motion_x = queue->motion_x * GENQUEUE_MOTION_DECAY + (x - queue->viewer_x);
+		queue->motion_y = queue->motion_y * GENQUEUE_MOTION_DECAY + (y - queue->viewer_y);
+	}
+
+	queue->viewer_x = x;
+	queue->viewer_y = y;
+
+	int low_x = floor((x - half_width) / chunk_size), high_x = ceil((x + half_width) / chunk_size);
+	int low_y = floor((y - half_height) / chunk_size), high_y = ceil((y + half_height) / chunk_size);
+	int direction_x = queue->motion_x > GENQUEUE_MOTION_THRESHOLD ? 1 : queue->motion_x < -GENQUEUE_MOTION_THRESHOLD ? -1 : 0;
+	int direction_y = queue->motion_y > GENQUEUE_MOTION_THRESHOLD ? 1 : queue->motion_y < -GENQUEUE_MOTION_THRESHOLD ? -1 : 0;
+	int radius = queue->prefetch_radius;
+
+	GenerationView view = {low_x, low_y, high_x, high_y, direction_x, direction_y, radius};
+	if (queue->has_viewer && memcmp(&view, &queue->view, sizeof(view)) == 0) return;
+
+	queue->has_viewer = 1;
+	queue->view = view;
+
+	for (int i = 0; i < queue->job_count; i++) {
+		Chunk* chunk = world_get_chunk(world, queue->jobs[i].x, queue->jobs[i].y);
+		if (chunk_get_stage(chunk) == CHUNK_PENDING) chunk_set_stage(chunk, CHUNK_EMPTY);
+	}
+
+	queue->job_count = 0;
+
+	// the ring reaches further ahead of the viewer
+	int ring_low_x = low_x - radius - (direction_x < 0 ? radius : 0);
+	int ring_high_x = high_x + radius + (direction_x > 0 ? radius : 0);
+	int ring_low_y = low_y - radius - (direction_y < 0 ? radius : 0);
+	int ring_high_y = high_y + radius + (direction_y > 0 ? radius : 0);
+
+	// chunks in the ring are ordered by how close they are to where the viewer is heading
+	double direction_length = sqrt(direction_x * direction_x + direction_y * direction_y);
+	double lead_x = x, lead_y = y;
+	if (direction_length > 0) {
+		lead_x += direction_x / direction_length * radius * chunk_size;
+		lead_y += direction_y / direction_length * radius * chunk_size;
+	}
+
+	for (int u = ring_low_x; u <= ring_high_x; u++) {
+		for (int v = ring_low_y; v <= ring_high_y; v++) {
+			Chunk* chunk = world_get_chunk(world, u, v);
+			if (chunk == NULL) chunk = world_create_chunk(world, u, v);
+			if (chunk_get_stage(chunk) != CHUNK_EMPTY) continue;
+
+			GenerationJob job;
+			job.x = u;
+			job.y = v;
+			job.is_visible = u >= low_x && u <= high_x && v >= low_y && v <= high_y;
+
+			double center_x = (u + 0.5) * chunk_size, center_y = (v + 0.5) * chunk_size;
+			double target_x = job.is_visible ? x : lead_x, target_y = job.is_visible ? y : lead_y;
+			job.distance = (center_x - target_x) * (center_x - target_x) + (center_y - target_y) * (center_y - target_y);
+
+			chunk_set_stage(chunk, CHUNK_PENDING);
+			push_job(queue, job);
+		}
+	}
+
+	qsort(queue->jobs, queue->job_count, sizeof(GenerationJob), compare_jobs);
+}
+
+// generate chunks in order for about budget_us microseconds, returns how many chunks are left to generate
+int genqueue_work_for(GenerationQueue* queue, int budget_us) {
+	Superposition* superposition = queue->superposition;
+	int chunk_size = queue->world->chunk_size;
+	double deadline = emscripten_get_now() + budget_us / 1000.0;
+
+	do {
+		if (queue->current_chunk == NULL) {
+			if (queue->job_count == 0) break;
+
+			GenerationJob job = queue->jobs[--queue->job_count];
+			Chunk* chunk = world_get_chunk(queue->world, job.x, job.y);
+
+			superposition_begin_collapse_area(superposition, job.x * chunk_size - superposition->x, job.y * chunk_size - superposition->y, chunk_size, chunk_size);
+			chunk_set_stage(chunk, CHUNK_INITIALIZING);
+			queue->current_chunk = chunk;
+			queue->current_is_visible = job.is_visible;
+		}
+
+		int remaining_us = (deadline - emscripten_get_now()) * 1000;
+		int result = superposition_collapse_for(superposition, remaining_us > 0 ? remaining_us : 0);
+
+		if (superposition_get_init_phase(superposition) == INIT_DONE)
+			chunk_set_stage(queue->current_chunk, CHUNK_COLLAPSING);
+
+		if (result != COLLAPSE_UNFINISHED) {
+			chunk_set_stage(queue->current_chunk, result == COLLAPSE_FAILED ? CHUNK_FAILED : CHUNK_GENERATED);
+			queue->current_chunk = NULL;
+		}
+	} while (emscripten_get_now() < deadline);
+
+	return genqueue_get_pending(queue);
+}
+
+// chunks queued or being generated
+int genqueue_get_pending(GenerationQueue* queue) {
+	return queue->job_count + (queue->current_chunk != NULL);
+}
+
+int genqueue_get_visible_pending(GenerationQueue* queue) {
+	int pending = queue->current_chunk != NULL && queue->current_is_visible;
+
+	// visible jobs are sorted to the end
+	for (int i = queue->job_count - 1; i >= 0 && queue->jobs[i].is_visible; i--) {
+		pending++;
+	}
+
+	return pending;
+}
+
+GenerationQueue* genqueue_create(World* world, Superposition* superposition) {
+	GenerationQueue* queue = malloc_inst(sizeof(GenerationQueue));
+
+	if (queue == NULL) {
+		fprintf(stderr, "Failed to allocate memory: genqueue_create()\n");
+		exit(1);
+	}
+
+	queue->world = world;
+	queue->superposition = superposition;
+	queue->prefetch_radius = DEFAULT_PREFETCH_RADIUS;
+
+	queue->job_capacity = 64;
+	queue->job_count = 0;
+	queue->jobs = malloc_inst(queue->job_capacity * sizeof(GenerationJob));
+
+	if (queue->jobs == NULL) {
+		fprintf(stderr, "Failed to allocate memory: genqueue_create()\n");
+		exit(1);
+	}
+
+	queue->current_chunk = NULL;
+	queue->current_is_visible = 0;
+	queue->has_viewer = 0;
+	queue->viewer_x = 0;
+	queue->viewer_y = 0;
+	queue->motion_x = 0;
+	queue->motion_y = 0;
+	memset(&queue->view, 0, sizeof(queue->view));
+
+	return queue;
+}
@@ -0,0 +1,67 @@
+#ifndef GENQUEUE_GUARD
+#define GENQUEUE_GUARD
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "meminst.h"
+#include "platform.h"
+#include "superposition.h"
+#include "world.h"
+
+#define DEFAULT_PREFETCH_RADIUS 1
+#define GENQUEUE_MOTION_DECAY 0.9	   // how much of the motion is kept each time the viewer is set
+#define GENQUEUE_MOTION_THRESHOLD 0.05  // tiles, slower motion doesn't lean the ring any way
+
+// a chunk waiting to be generated
+typedef struct {
+	int x;
+	int y;
+	int is_visible;
+	double distance;  // squared distance in tiles, to the viewer for visible chunks and ahead of it for the rest
+} GenerationJob;
+
+// what the queue was last built for, chunk ranges of the view and the direction it was heading in
+typedef struct {
+	int low_x;
+	int low_y;
+	int high_x;
+	int high_y;
+	int direction_x;
+	int direction_y;
+	int radius;
+} GenerationView;
+
+// generates chunks around a viewer, visible chunks first, then a ring of chunks around them
+// the ring reaches twice as far on the sides the viewer is moving towards
+typedef struct {
+	World* world;
+	Superposition* superposition;  // its distribution area is used for every chunk
+	int prefetch_radius;		   // in chunks
+
+	GenerationJob* jobs;  // sorted so the next job is at the end
+	int job_count;
+	int job_capacity;
+
+	Chunk* current_chunk;  // chunk the superposition is working on, it's always finished before the next one starts
+	int current_is_visible;
+
+	int has_viewer;
+	double viewer_x;
+	double viewer_y;
+	double motion_x;  // decaying sum of the viewer's recent moves
+	double motion_y;
+	GenerationView view;
+} GenerationQueue;
+
+extern EMSCRIPTEN_KEEPALIVE GenerationQueue* genqueue_create(World* world, Superposition* superposition);
+extern EMSCRIPTEN_KEEPALIVE void genqueue_set_prefetch_radius(GenerationQueue* queue, int radius);
+extern EMSCRIPTEN_KEEPALIVE void genqueue_set_viewer(GenerationQueue* queue, double x, double y, double half_width, double half_height);
+extern EMSCRIPTEN_KEEPALIVE int genqueue_work_for(GenerationQueue* queue, int budget_us);
+extern EMSCRIPTEN_KEEPALIVE int genqueue_get_pending(GenerationQueue* queue);
+extern EMSCRIPTEN_KEEPALIVE int genqueue_get_visible_pending(GenerationQueue* queue);
+extern EMSCRIPTEN_KEEPALIVE void genqueue_free(GenerationQueue* queue);
+
+#endif
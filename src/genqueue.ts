@@ -0,0 +1,85 @@
+import { SimpleSuperposition } from "./superposition";
+import { World } from "./world";
+
+let genqueue_create: (world: number, superposition: number) => number;
+let genqueue_set_prefetch_radius: (queue: number, radius: number) => void;
+let genqueue_set_viewer: (queue: number, x: number, y: number, halfWidth: number, halfHeight: number) => void;
+let genqueue_work_for: (queue: number, budgetUs: number) => number;
+let genqueue_get_pending: (queue: number) => number;
+let genqueue_get_visible_pending: (queue: number) => number;
+let genqueue_free: (queue: number) => void;
+
+const genqueueRegistry = new FinalizationRegistry((ptr: number) => {
+    genqueue_free(ptr);
+});
+
+export function init() {
+    genqueue_create = cwrap("genqueue_create", "number", ["number", "number"]);
+    genqueue_set_prefetch_radius = cwrap("genqueue_set_prefetch_radius", null, ["number", "number"]);
+    genqueue_set_viewer = cwrap("genqueue_set_viewer", null, ["number", "number", "number", "number", "number"]);
+    genqueue_work_for = cwrap("genqueue_work_for", "number", ["number", "number"]);
+    genqueue_get_pending = cwrap("genqueue_get_pending", "number", ["number"]);
+    genqueue_get_visible_pending = cwrap("genqueue_get_visible_pending", "number", ["number"]);
+    genqueue_free = cwrap("genqueue_free", null, ["number"]);
+}
+
+// generates chunks around the camera, visible ones first and a prefetch ring around them when there's time
+export class GenerationQueue {
+    readonly ptr: number;
+    readonly world: World;
+    readonly superposition: SimpleSuperposition; // kept to stop premature deallocation
+
+    private idleWorkRequested = false;
+
+    static create(world: World, superposition: SimpleSuperposition, prefetchRadius?: number): GenerationQueue {
+        const queue = new GenerationQueue(genqueue_create(world.ptr, superposition.ptr), world, superposition);
+        if (prefetchRadius !== undefined) genqueue_set_prefetch_radius(queue.ptr, prefetchRadius);
+
+        genqueueRegistry.register(queue, queue.ptr, queue);
+        return queue;
+    }
+
+    constructor(ptr: number, world: World, superposition: SimpleSuperposition) {
+        this.ptr = ptr;
+        this.world = world;
+        this.superposition = superposition;
+    }
+
+    set prefetchRadius(radius: number) {
+        genqueue_set_prefetch_radius(this.ptr, radius);
+    }
+
+    // view is given in tiles, it covers x - halfWidth to x + halfWidth
+    setViewer(x: number, y: number, halfWidth: number, halfHeight: number) {
+        genqueue_set_viewer(this.ptr, x, y, halfWidth, halfHeight);
+        this.requestIdleWork();
+    }
+
+    workFor(budgetMs: number): number {
+        return genqueue_work_for(this.ptr, Math.round(budgetMs * 1000));
+    }
+
+    get pending(): number {
+        return genqueue_get_pending(this.ptr);
+    }
+
+    get visiblePending(): number {
+        return genqueue_get_visible_pending(this.ptr);
+    }
+
+    // background chunks are generated while the browser is idle
+    private requestIdleWork() {
+        if (this.idleWorkRequested) return;
+        this.idleWorkRequested = true;
+
+        requestIdleCallback((deadline) => {
+            this.idleWorkRequested = false;
+            if (this.workFor(deadline.timeRemaining()) > 0) this.requestIdleWork();
+        });
+    }
+
+    free() {
+        genqueueRegistry.unregister(this);
+        genqueue_free(this.ptr);
+    }
+}
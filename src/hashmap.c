@@ -90,6 +90,9 @@ void hashmap_grow(Hashmap* hashmap, int new_size) {
 		exit(1);
 	}
 
+	// new buckets start empty
+	memset(hashmap->nodes + hashmap->size, 0, (new_size - hashmap->size) * sizeof(HashmapNode*));
+
 	for (int i = 0; i < hashmap->size; i++) {
 		hashmap_grow_bucket(hashmap, hashmap->nodes[i], hashmap->size, new_size);
 	}
@@ -20,10 +20,11 @@ typedef struct {
 	HashmapNode** nodes;
 } Hashmap;
 
-#define hashkey_from_pair(x, y) ((uint64_t)(unsigned int)x + ((uint64_t)(unsigned int)y << 32))
-#define x_from_hashkey(key) ((unsigned int)(key & 0xFFFFFFFF))
-#define y_from_hashkey(key) ((unsigned int)(key >> 32))
+#define hashkey_from_pair(x, y) ((uint64_t)(unsigned int)(x) + ((uint64_t)(unsigned int)(y) << 32))
+#define x_from_hashkey(key) ((unsigned int)((key) & 0xFFFFFFFF))
+#define y_from_hashkey(key) ((unsigned int)((key) >> 32))
 
+uint32_t jenkins_hash(int key_length, uint8_t* key);
 Hashmap* hashmap_create(int inital_size);
 void* hashmap_set(Hashmap* hashmap, uint64_t key, void* value);
 void* hashmap_get(Hashmap* hashmap, uint64_t key);
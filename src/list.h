@@ -1,8 +1,8 @@
-#include <emscripten.h>
 #include <stdint.h>
 #include <stdio.h>
 
 #include "meminst.h"
+#include "platform.h"
 
 typedef struct {
 	int length;
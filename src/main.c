@@ -1,7 +1,5 @@
 #include "main.h"
 
 int main() {
-	srand(time(0));
-
 	return 0;
 }
\ No newline at end of file
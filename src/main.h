@@ -1,6 +1,6 @@
-#include <emscripten.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
 
+#include "platform.h"
 #include "superposition.h"
\ No newline at end of file
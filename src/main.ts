@@ -1,5 +1,6 @@
 import { init as initWrapper } from "./cwrapper";
 import { Distribution } from "./distribution";
+import { GenerationQueue } from "./genqueue";
 import { Renderer } from "./render";
 import { SimpleSuperposition } from "./superposition";
 import { Tileset } from "./tileset";
@@ -27,7 +28,6 @@ async function init() {
     const roadIntersection = tileset.addTile(11, 0, roadEdge, roadEdge, roadEdge, roadEdge);
 
     const world = World.create(8, tileset);
-    world.createChunk(0, 0);
 
     const distribution = Distribution.create(tileset);
     distribution.addTile(dirt, 50);
@@ -41,15 +41,12 @@ async function init() {
     distribution.addTile(roadIntersection, 1);
 
     const superposition = SimpleSuperposition.create(world, distribution);
-    superposition.selectCollapseArea(0, 0, 8, 8);
+    const generationQueue = GenerationQueue.create(world, superposition);
 
     renderer.setWorld(world);
+    renderer.setGenerationQueue(generationQueue);
     renderer.camera.position.add(new Vector2(4, 4));
     renderer.start();
-
-    window.addEventListener("click", () => {
-        superposition.collapse(1);
-    });
 }
 
 init();
\ No newline at end of file
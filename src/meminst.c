@@ -1,6 +1,7 @@
 #include "meminst.h"
 
-size_t memory_usage = 0;
+// memory is allocated from generation threads too
+_Atomic size_t memory_usage = 0;
 
 int get_memory_usage() {
 #ifndef DO_MEMORY_INSTRUMENTATION
@@ -1,11 +1,12 @@
 #ifndef MEMINST_GUARD
 #define MEMINST_GUARD
 
-#include <emscripten.h>
 #include <malloc.h>
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "platform.h"
+
 EMSCRIPTEN_KEEPALIVE extern void* malloc_inst(size_t size);
 EMSCRIPTEN_KEEPALIVE extern void* calloc_inst(size_t nmemb, size_t size);
 EMSCRIPTEN_KEEPALIVE extern void* realloc_inst(void* ptr, size_t size);
@@ -8,6 +8,6 @@ export function init() {
     mallocInst = cwrap("malloc_inst", "number", ["number"]);
     callocInst = cwrap("calloc_inst", "number", ["number", "number"]);
     reallocInst = cwrap("realloc_inst", "number", ["number", "number"]);
-    freeInst = cwrap("realloc_inst", null, ["number"]);
+    freeInst = cwrap("free_inst", null, ["number"]);
     getMemoryUsage = cwrap("get_memory_usage", "number", []);
 }
\ No newline at end of file
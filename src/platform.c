@@ -0,0 +1,11 @@
+#include "platform.h"
+
+#ifndef __EMSCRIPTEN__
+// milliseconds from an arbitrary point, the same as emscripten's
+double emscripten_get_now() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return now.tv_sec * 1000.0 + now.tv_nsec / 1000000.0;
+}
+#endif
@@ -0,0 +1,16 @@
+#ifndef PLATFORM_GUARD
+#define PLATFORM_GUARD
+
+// the little of emscripten the core uses, so it also builds natively, see make dist/libwfc.a
+#ifdef __EMSCRIPTEN__
+#include <emscripten.h>
+#else
+#include <time.h>
+
+// exports only matter to the web build
+#define EMSCRIPTEN_KEEPALIVE
+
+double emscripten_get_now();
+#endif
+
+#endif
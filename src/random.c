@@ -0,0 +1,37 @@
+#include "random.h"
+
+// splitmix64 finalizer, every bit of the input affects every bit of the output
+uint64_t random_mix(uint64_t z) {
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+	return z ^ (z >> 31);
+}
+
+void random_stream_seed(RandomStream* stream, uint32_t seed, int x, int y) {
+	uint64_t position = (uint64_t)(uint32_t)x << 32 | (uint32_t)y;
+	stream->key = random_mix(random_mix(seed) ^ position);
+	stream->counter = 0;
+}
+
+// splitmix64 with the state replaced by key + counter * gamma
+uint32_t random_next(RandomStream* stream) {
+	stream->counter++;
+	return random_mix(stream->key + stream->counter * 0x9E3779B97F4A7C15ull) >> 32;
+}
+
+// uniform in [0, bound), multiply and reject instead of a modulo, see Lemire's "Fast Random Integer Generation in an Interval"
+uint32_t random_below(RandomStream* stream, uint32_t bound) {
+	uint64_t product = (uint64_t)random_next(stream) * bound;
+	uint32_t low = product;
+
+	if (low < bound) {
+		uint32_t threshold = -bound % bound;
+
+		while (low < threshold) {
+			product = (uint64_t)random_next(stream) * bound;
+			low = product;
+		}
+	}
+
+	return product >> 32;
+}
@@ -0,0 +1,18 @@
+#ifndef RANDOM_GUARD
+#define RANDOM_GUARD
+
+#include <stdint.h>
+
+// counter based random numbers, the nth number of a stream only depends on its key and n
+// streams are keyed by a world seed and a position, so a chunk rolls the same numbers whichever thread
+// generates it and whatever was generated before it
+typedef struct {
+	uint64_t key;
+	uint64_t counter;
+} RandomStream;
+
+void random_stream_seed(RandomStream* stream, uint32_t seed, int x, int y);
+uint32_t random_next(RandomStream* stream);
+uint32_t random_below(RandomStream* stream, uint32_t bound);
+
+#endif
@@ -1,5 +1,6 @@
 import * as twgl from "twgl.js";
 import { Camera } from "./camera";
+import { GenerationQueue } from "./genqueue";
 import { World } from "./world";
 import { freeInst } from "./meminst";
 
@@ -19,6 +20,8 @@ export class Renderer extends EventTarget {
 
     camera: Camera;
     world: World | null = null;
+    generationQueue: GenerationQueue | null = null;
+    generationBudget = 4; // ms per frame spent on visible chunks
 
     frameReleventPointers: number[] = [];
 
@@ -65,6 +68,10 @@ export class Renderer extends EventTarget {
         this.world = world;
     }
 
+    setGenerationQueue(queue: GenerationQueue) {
+        this.generationQueue = queue;
+    }
+
     start() {
         requestAnimationFrame(this.frame.bind(this));
     }
@@ -75,6 +82,7 @@ export class Renderer extends EventTarget {
         twgl.resizeCanvasToDisplaySize(this.canvas);
         gl.viewport(0, 0, gl.canvas.width, gl.canvas.height);
 
+        this.updateGeneration();
         this.updateWorldTexture();
 
         const zoom = this.camera.size / Math.min(this.canvas.width, this.canvas.height);
@@ -103,10 +111,22 @@ export class Renderer extends EventTarget {
 
         // release memory used for frame rendering
         for (const ptr of this.frameReleventPointers) freeInst(ptr);
+        this.frameReleventPointers = [];
 
         this.dispatchEvent(new CustomEvent("frame"));
     }
 
+    // visible chunks get a slice of every frame, the rest are left for idle time
+    updateGeneration() {
+        const queue = this.generationQueue;
+        if (queue == null) return;
+
+        const zoom = this.camera.size / Math.min(this.canvas.width, this.canvas.height);
+        queue.setViewer(this.camera.position.x, this.camera.position.y, this.canvas.width * zoom / 2, this.canvas.height * zoom / 2);
+
+        if (queue.visiblePending > 0) queue.workFor(this.generationBudget);
+    }
+
     updateWorldTexture() {
         const gl = this.gl, world = this.world;
 
@@ -0,0 +1,211 @@
+#include "scheduler.h"
+
+void scheduler_free(Scheduler* scheduler) {
+	pthread_mutex_lock(&scheduler->lock);
+	scheduler->stopping = 1;
+	pthread_cond_broadcast(&scheduler->work_changed);
+	pthread_mutex_unlock(&scheduler->lock);
+
+	for (int i = 0; i < scheduler->thread_count; i++) {
+		pthread_join(scheduler->workers[i].thread, NULL);
+		superposition_free(scheduler->workers[i].superposition);
+	}
+
+	pthread_cond_destroy(&scheduler->work_changed);
+	pthread_mutex_destroy(&scheduler->lock);
+
+	hashmap_free(scheduler->generating_chunks, NULL);
+	free_inst(scheduler->pending_chunks);
+	free_inst(scheduler->workers);
+	free_inst(scheduler);
+}
+
+// a chunk can be generated once none of the chunks sharing a border with it are being generated
+int is_chunk_ready(Scheduler* scheduler, int x, int y) {
+	Hashmap* generating = scheduler->generating_chunks;
+
+	return !hashmap_has(generating, hashkey_from_pair(x + 1, y)) && !hashmap_has(generating, hashkey_from_pair(x - 1, y)) &&
+		   !hashmap_has(generating, hashkey_from_pair(x, y + 1)) && !hashmap_has(generating, hashkey_from_pair(x, y - 1));
+}
+
+// take the first queued chunk that is ready, must be called with the lock held
+Chunk* take_ready_chunk(Scheduler* scheduler) {
+	for (int i = 0; i < scheduler->pending_length; i++) {
+		uint64_t key = scheduler->pending_chunks[i];
+		int x = x_from_hashkey(key), y = y_from_hashkey(key);
+
+		if (!is_chunk_ready(scheduler, x, y)) continue;
+
+		memmove(scheduler->pending_chunks + i, scheduler->pending_chunks + i + 1, (scheduler->pending_length - i - 1) * sizeof(uint64_t));
+		scheduler->pending_length--;
+
+		Chunk* chunk = world_get_chunk(scheduler->world, x, y);
+		chunk_set_stage(chunk, CHUNK_COLLAPSING);
+		hashmap_set(scheduler->generating_chunks, key, chunk);
+		scheduler->generating_count++;
+
+		return chunk;
+	}
+
+	return NULL;
+}
+
+void generate_chunk(Scheduler* scheduler, Superposition* superposition, Chunk* chunk) {
+	int chunk_size = scheduler->world->chunk_size;
+	int u = chunk->x * chunk_size - scheduler->area_x, v = chunk->y * chunk_size - scheduler->area_y;
+
+	superposition_select_collapse_area(superposition, u, v, chunk_size, chunk_size);
+
+	int result;
+	while ((result = superposition_collapse_tiles(superposition, chunk_size * chunk_size)) == COLLAPSE_UNFINISHED);
+	chunk_set_stage(chunk, result == COLLAPSE_FAILED ? CHUNK_FAILED : CHUNK_GENERATED);
+
+	pthread_mutex_lock(&scheduler->lock);
+
+	hashmap_delete(scheduler->generating_chunks, hashkey_from_pair(chunk->x, chunk->y));
+	scheduler->generating_count--;
+
+	if (result == COLLAPSE_FAILED) {
+		scheduler->failed_count++;
+	} else {
+		scheduler->generated_count++;
+	}
+
+	// neighbours waiting on this chunk might be ready now
+	pthread_cond_broadcast(&scheduler->work_changed);
+	pthread_mutex_unlock(&scheduler->lock);
+}
+
+void* run_worker(void* arg) {
+	SchedulerWorker* worker = arg;
+	Scheduler* scheduler = worker->scheduler;
+
+	pthread_mutex_lock(&scheduler->lock);
+
+	while (!scheduler->stopping) {
+		Chunk* chunk = take_ready_chunk(scheduler);
+
+		if (chunk == NULL) {
+			pthread_cond_wait(&scheduler->work_changed, &scheduler->lock);
+			continue;
+		}
+
+		pthread_mutex_unlock(&scheduler->lock);
+		generate_chunk(scheduler, worker->superposition, chunk);
+		pthread_mutex_lock(&scheduler->lock);
+	}
+
+	pthread_mutex_unlock(&scheduler->lock);
+
+	return NULL;
+}
+
+// creates the chunk right away, its tiles stay empty until a worker has generated it
+Chunk* scheduler_queue_chunk(Scheduler* scheduler, int x, int y) {
+	Chunk* chunk = world_create_chunk(scheduler->world, x, y);
+	chunk_set_stage(chunk, CHUNK_PENDING);
+
+	pthread_mutex_lock(&scheduler->lock);
+
+	if (scheduler->pending_length == scheduler->pending_capacity) {
+		scheduler->pending_capacity *= 2;
+		scheduler->pending_chunks = realloc_inst(scheduler->pending_chunks, scheduler->pending_capacity * sizeof(uint64_t));
+
+		if (scheduler->pending_chunks == NULL) {
+			fprintf(stderr, "Failed to allocate memory: scheduler_queue_chunk()\n");
+			exit(1);
+		}
+	}
+
+	scheduler->pending_chunks[scheduler->pending_length++] = hashkey_from_pair(x, y);
+
+	pthread_cond_broadcast(&scheduler->work_changed);
+	pthread_mutex_unlock(&scheduler->lock);
+
+	return chunk;
+}
+
+// chunks queued or being generated
+int scheduler_get_pending(Scheduler* scheduler) {
+	pthread_mutex_lock(&scheduler->lock);
+	int pending = scheduler->pending_length + scheduler->generating_count;
+	pthread_mutex_unlock(&scheduler->lock);
+
+	return pending;
+}
+
+int scheduler_get_generated(Scheduler* scheduler) {
+	pthread_mutex_lock(&scheduler->lock);
+	int generated = scheduler->generated_count;
+	pthread_mutex_unlock(&scheduler->lock);
+
+	return generated;
+}
+
+int scheduler_get_failed(Scheduler* scheduler) {
+	pthread_mutex_lock(&scheduler->lock);
+	int failed = scheduler->failed_count;
+	pthread_mutex_unlock(&scheduler->lock);
+
+	return failed;
+}
+
+// block until every queued chunk is generated, don't call this from the browser's main thread
+void scheduler_wait(Scheduler* scheduler) {
+	pthread_mutex_lock(&scheduler->lock);
+
+	while (scheduler->pending_length + scheduler->generating_count > 0) {
+		pthread_cond_wait(&scheduler->work_changed, &scheduler->lock);
+	}
+
+	pthread_mutex_unlock(&scheduler->lock);
+}
+
+// the distribution area is shared by every worker and placed at area_x, area_y in the world
+Scheduler* scheduler_create(World* world, int area_x, int area_y, DistributionArea* area, int thread_count) {
+	Scheduler* scheduler = malloc_inst(sizeof(Scheduler));
+
+	if (scheduler == NULL) {
+		fprintf(stderr, "Failed to allocate memory: scheduler_create()\n");
+		exit(1);
+	}
+
+	scheduler->world = world;
+	scheduler->area = area;
+	scheduler->area_x = area_x;
+	scheduler->area_y = area_y;
+
+	scheduler->pending_capacity = 16;
+	scheduler->pending_length = 0;
+	scheduler->pending_chunks = malloc_inst(scheduler->pending_capacity * sizeof(uint64_t));
+	scheduler->generating_chunks = hashmap_create(64);
+	scheduler->generating_count = 0;
+	scheduler->generated_count = 0;
+	scheduler->failed_count = 0;
+	scheduler->stopping = 0;
+
+	scheduler->thread_count = thread_count;
+	scheduler->workers = malloc_inst(thread_count * sizeof(SchedulerWorker));
+
+	if (scheduler->pending_chunks == NULL || scheduler->workers == NULL) {
+		fprintf(stderr, "Failed to allocate memory: scheduler_create()\n");
+		exit(1);
+	}
+
+	pthread_mutex_init(&scheduler->lock, NULL);
+	pthread_cond_init(&scheduler->work_changed, NULL);
+
+	for (int i = 0; i < thread_count; i++) {
+		SchedulerWorker* worker = &scheduler->workers[i];
+		worker->scheduler = scheduler;
+		worker->superposition = superposition_create(world);
+		superposition_select_distribution_area(worker->superposition, area_x, area_y, area);
+
+		if (pthread_create(&worker->thread, NULL, run_worker, worker) != 0) {
+			fprintf(stderr, "Failed to start thread: scheduler_create()\n");
+			exit(1);
+		}
+	}
+
+	return scheduler;
+}
@@ -0,0 +1,56 @@
+#ifndef SCHEDULER_GUARD
+#define SCHEDULER_GUARD
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "distribution.h"
+#include "hashmap.h"
+#include "meminst.h"
+#include "platform.h"
+#include "superposition.h"
+#include "world.h"
+
+struct Scheduler;
+
+typedef struct {
+	struct Scheduler* scheduler;
+	Superposition* superposition;
+	pthread_t thread;
+} SchedulerWorker;
+
+// generates chunks on a pool of threads, each with its own superposition
+// chunks next to each other are never generated at the same time so the borders they read from the world stay fixed
+typedef struct Scheduler {
+	World* world;
+	DistributionArea* area;
+	int area_x;
+	int area_y;
+
+	int thread_count;
+	SchedulerWorker* workers;
+
+	// everything below is guarded by lock
+	pthread_mutex_t lock;
+	pthread_cond_t work_changed;  // chunks were queued, finished or the scheduler is stopping
+	uint64_t* pending_chunks;	  // hashkeys of queued chunks in the order they were queued
+	int pending_length;
+	int pending_capacity;
+	Hashmap* generating_chunks;	 // chunks being generated right now
+	int generating_count;
+	int generated_count;
+	int failed_count;
+	int stopping;
+} Scheduler;
+
+extern EMSCRIPTEN_KEEPALIVE Scheduler* scheduler_create(World* world, int area_x, int area_y, DistributionArea* area, int thread_count);
+extern EMSCRIPTEN_KEEPALIVE Chunk* scheduler_queue_chunk(Scheduler* scheduler, int x, int y);
+extern EMSCRIPTEN_KEEPALIVE int scheduler_get_pending(Scheduler* scheduler);
+extern EMSCRIPTEN_KEEPALIVE int scheduler_get_generated(Scheduler* scheduler);
+extern EMSCRIPTEN_KEEPALIVE int scheduler_get_failed(Scheduler* scheduler);
+void scheduler_wait(Scheduler* scheduler);
+extern EMSCRIPTEN_KEEPALIVE void scheduler_free(Scheduler* scheduler);
+
+#endif
@@ -0,0 +1,63 @@
+import { DistributionArea } from "./distribution";
+import { Chunk, World } from "./world";
+
+let scheduler_create: (world: number, areaX: number, areaY: number, area: number, threadCount: number) => number;
+let scheduler_queue_chunk: (scheduler: number, x: number, y: number) => number;
+let scheduler_get_pending: (scheduler: number) => number;
+let scheduler_get_generated: (scheduler: number) => number;
+let scheduler_get_failed: (scheduler: number) => number;
+let scheduler_free: (scheduler: number) => void;
+
+const schedulerRegistry = new FinalizationRegistry((ptr: number) => {
+    scheduler_free(ptr);
+});
+
+export function init() {
+    scheduler_create = cwrap("scheduler_create", "number", ["number", "number", "number", "number", "number"]);
+    scheduler_queue_chunk = cwrap("scheduler_queue_chunk", "number", ["number", "number", "number"]);
+    scheduler_get_pending = cwrap("scheduler_get_pending", "number", ["number"]);
+    scheduler_get_generated = cwrap("scheduler_get_generated", "number", ["number"]);
+    scheduler_get_failed = cwrap("scheduler_get_failed", "number", ["number"]);
+    scheduler_free = cwrap("scheduler_free", null, ["number"]);
+}
+
+// generates chunks on worker threads, finished tiles show up in the world as the renderer polls for undisplayed chunks
+export class Scheduler {
+    readonly ptr: number;
+    readonly world: World; // kept to stop premature deallocation
+    readonly area: DistributionArea; // kept to stop premature deallocation
+
+    static create(world: World, area: DistributionArea, threadCount = navigator.hardwareConcurrency): Scheduler {
+        const scheduler = new Scheduler(scheduler_create(world.ptr, 0, 0, area.ptr, threadCount), world, area);
+        schedulerRegistry.register(scheduler, scheduler.ptr, scheduler);
+        return scheduler;
+    }
+
+    constructor(ptr: number, world: World, area: DistributionArea) {
+        this.ptr = ptr;
+        this.world = world;
+        this.area = area;
+    }
+
+    queueChunk(x: number, y: number): Chunk {
+        return new Chunk(scheduler_queue_chunk(this.ptr, x, y), this.world);
+    }
+
+    // chunks queued or being generated
+    get pending(): number {
+        return scheduler_get_pending(this.ptr);
+    }
+
+    get generated(): number {
+        return scheduler_get_generated(this.ptr);
+    }
+
+    get failed(): number {
+        return scheduler_get_failed(this.ptr);
+    }
+
+    free() {
+        schedulerRegistry.unregister(this);
+        scheduler_free(this.ptr);
+    }
+}
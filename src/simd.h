@@ -0,0 +1,122 @@
+#ifndef SIMD_GUARD
+#define SIMD_GUARD
+
+#include <stdint.h>
+#include <string.h>
+
+// the wasm simd intrinsics the core uses, so it builds natively as well as with emscripten
+// wasm builds use the real ones, native builds get SSE2 versions or plain C ones when there's no SSE2
+// wasm_i32x4_shuffle only takes lanes from its first argument, the core never mixes two vectors
+#if defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+
+#elif defined(__SSE2__)
+#include <immintrin.h>
+
+typedef __m128i v128_t;
+
+#define wasm_v128_load(p) _mm_loadu_si128((const __m128i*)(p))
+#define wasm_v128_store(p, a) _mm_storeu_si128((__m128i*)(p), a)
+#define wasm_v128_or(a, b) _mm_or_si128(a, b)
+#define wasm_v128_and(a, b) _mm_and_si128(a, b)
+#define wasm_v128_xor(a, b) _mm_xor_si128(a, b)
+#define wasm_v128_andnot(a, b) _mm_andnot_si128(b, a)
+#define wasm_v128_any_true(a) (_mm_movemask_epi8(_mm_cmpeq_epi8(a, _mm_setzero_si128())) != 0xFFFF)
+
+#define wasm_i8x16_shuffle(a, b, ...) ((v128_t)__builtin_shufflevector((__v16qu)(a), (__v16qu)(b), __VA_ARGS__))
+#define wasm_u8x16_add_sat(a, b) _mm_adds_epu8(a, b)
+#define wasm_u8x16_extract_lane(a, i) ((uint8_t)_mm_cvtsi128_si32(_mm_srli_si128(a, i)))
+
+#define wasm_i32x4_splat(a) _mm_set1_epi32(a)
+#define wasm_i32x4_make(a, b, c, d) _mm_setr_epi32(a, b, c, d)
+#define wasm_i32x4_add(a, b) _mm_add_epi32(a, b)
+#define wasm_i32x4_shuffle(a, b, c0, c1, c2, c3) _mm_shuffle_epi32(a, _MM_SHUFFLE(c3, c2, c1, c0))
+#define wasm_i32x4_extract_lane(a, i) _mm_cvtsi128_si32(_mm_srli_si128(a, (i) * 4))
+
+// no byte popcount before AVX512, count bits in pairs then nibbles then bytes
+static inline v128_t wasm_i8x16_popcnt(v128_t a) {
+	a = _mm_sub_epi8(a, _mm_and_si128(_mm_srli_epi16(a, 1), _mm_set1_epi8(0x55)));
+	a = _mm_add_epi8(_mm_and_si128(a, _mm_set1_epi8(0x33)), _mm_and_si128(_mm_srli_epi16(a, 2), _mm_set1_epi8(0x33)));
+	return _mm_and_si128(_mm_add_epi8(a, _mm_srli_epi16(a, 4)), _mm_set1_epi8(0x0F));
+}
+
+#else
+typedef union {
+	_Alignas(16) uint8_t u8[16];
+	int32_t i32[4];
+	uint64_t u64[2];
+} v128_t;
+
+static inline v128_t wasm_v128_load(const void* p) {
+	v128_t a;
+	memcpy(&a, p, sizeof(a));
+	return a;
+}
+
+static inline void wasm_v128_store(void* p, v128_t a) {
+	memcpy(p, &a, sizeof(a));
+}
+
+static inline v128_t wasm_v128_or(v128_t a, v128_t b) {
+	for (int i = 0; i < 2; i++) a.u64[i] |= b.u64[i];
+	return a;
+}
+
+static inline v128_t wasm_v128_and(v128_t a, v128_t b) {
+	for (int i = 0; i < 2; i++) a.u64[i] &= b.u64[i];
+	return a;
+}
+
+static inline v128_t wasm_v128_xor(v128_t a, v128_t b) {
+	for (int i = 0; i < 2; i++) a.u64[i] ^= b.u64[i];
+	return a;
+}
+
+static inline v128_t wasm_v128_andnot(v128_t a, v128_t b) {
+	for (int i = 0; i < 2; i++) a.u64[i] &= ~b.u64[i];
+	return a;
+}
+
+static inline int wasm_v128_any_true(v128_t a) {
+	return (a.u64[0] | a.u64[1]) != 0;
+}
+
+// lanes 16 to 31 come from b
+static inline v128_t simd_shuffle_bytes(v128_t a, v128_t b, const uint8_t* lanes) {
+	v128_t result;
+	for (int i = 0; i < 16; i++) result.u8[i] = lanes[i] < 16 ? a.u8[lanes[i]] : b.u8[lanes[i] - 16];
+	return result;
+}
+
+#define wasm_i8x16_shuffle(a, b, ...) simd_shuffle_bytes(a, b, (const uint8_t[16]){__VA_ARGS__})
+
+static inline v128_t wasm_i8x16_popcnt(v128_t a) {
+	for (int i = 0; i < 16; i++) a.u8[i] = __builtin_popcount(a.u8[i]);
+	return a;
+}
+
+static inline v128_t wasm_u8x16_add_sat(v128_t a, v128_t b) {
+	for (int i = 0; i < 16; i++) a.u8[i] = a.u8[i] + b.u8[i] > 255 ? 255 : a.u8[i] + b.u8[i];
+	return a;
+}
+
+#define wasm_u8x16_extract_lane(a, i) ((a).u8[i])
+
+static inline v128_t wasm_i32x4_make(int32_t a, int32_t b, int32_t c, int32_t d) {
+	v128_t result = {.i32 = {a, b, c, d}};
+	return result;
+}
+
+#define wasm_i32x4_splat(a) wasm_i32x4_make(a, a, a, a)
+
+// wraps around like the real thing
+static inline v128_t wasm_i32x4_add(v128_t a, v128_t b) {
+	for (int i = 0; i < 4; i++) a.i32[i] = (uint32_t)a.i32[i] + (uint32_t)b.i32[i];
+	return a;
+}
+
+#define wasm_i32x4_shuffle(a, b, c0, c1, c2, c3) wasm_i32x4_make((a).i32[c0], (a).i32[c1], (a).i32[c2], (a).i32[c3])
+#define wasm_i32x4_extract_lane(a, i) ((a).i32[i])
+#endif
+
+#endif
@@ -8,133 +8,477 @@ typedef enum {
 	BOTTOM
 } TileEdge;
 
+// index of a tile in the collapse area, tiles are ordered row by row inside a block and blocks are ordered row by row
+int get_tile_index(Superposition* superposition, int i, int j) {
+	int block = (i >> TILE_BLOCK_BITS) + (j >> TILE_BLOCK_BITS) * superposition->blocks_width;
+	return block << (2 * TILE_BLOCK_BITS) | (j & (TILE_BLOCK_SIZE - 1)) << TILE_BLOCK_BITS | (i & (TILE_BLOCK_SIZE - 1));
+}
+
+int get_tile_i(Superposition* superposition, int tile_index) {
+	int block = tile_index >> (2 * TILE_BLOCK_BITS);
+	return (block % superposition->blocks_width) << TILE_BLOCK_BITS | (tile_index & (TILE_BLOCK_SIZE - 1));
+}
+
+int get_tile_j(Superposition* superposition, int tile_index) {
+	int block = tile_index >> (2 * TILE_BLOCK_BITS);
+	return (block / superposition->blocks_width) << TILE_BLOCK_BITS | ((tile_index >> TILE_BLOCK_BITS) & (TILE_BLOCK_SIZE - 1));
+}
+
+// blocks on the edge of the area can hold tiles past it, these are never collapsed or propagated
+int is_tile_in_area(Superposition* superposition, int i, int j) {
+	return i < superposition->collapse_width && j < superposition->collapse_height;
+}
+
 void superposition_free(Superposition* superposition) {
-	free_inst(superposition->temp_edge_field);
+	free_inst(superposition->edge_fields);
 	free_inst(superposition->temp_tile_field);
-	free_inst(superposition->fields);
+	free_inst(superposition->trail_tiles);
+	free_inst(superposition->trail_fields);
+	free_inst(superposition->log_weight_table);
 
 	entropies_free(superposition->entropies);
-	hashmap_free(superposition->stale_entropy_tiles, NULL);
+	chunk_window_free(&superposition->chunks);
+	dirtyset_free(superposition->stale_entropy_tiles);
+	arena_free(superposition->tile_arena);
 
 	free_inst(superposition);
 }
 
-// update the entory for one tile, the value of this node in the hashmap is the superposition
-void* update_stale_entropies_map_func(uint64_t key, void* value) {
-	Superposition* superposition = (Superposition*)value;
-	int i = x_from_hashkey(key), j = y_from_hashkey(key);
+// tiles are given relative to the collapse area
+int get_world_tile(Superposition* superposition, int i, int j) {
+	return world_window_get(superposition->world, &superposition->chunks, superposition->x + superposition->u + i, superposition->y + superposition->v + j);
+}
+
+void set_world_tile(Superposition* superposition, int i, int j, int tile) {
+	world_window_set(superposition->world, &superposition->chunks, superposition->x + superposition->u + i, superposition->y + superposition->v + j, tile);
+}
+
+// fixed point log of a weight sum, the table grows to the largest sum seen so logf is only called once for each
+Entropy get_log_weight_sum(Superposition* superposition, Entropy weight_sum) {
+	if (weight_sum >= LOG_WEIGHT_TABLE_LIMIT) return (int)(logf(weight_sum) * ENTROPY_ONE_POINT);
+
+	if (weight_sum >= superposition->log_weight_table_size) {
+		int size = superposition->log_weight_table_size * 2 > weight_sum + 1 ? superposition->log_weight_table_size * 2 : weight_sum + 1;
+		if (size > LOG_WEIGHT_TABLE_LIMIT) size = LOG_WEIGHT_TABLE_LIMIT;
+
+		superposition->log_weight_table = realloc_inst(superposition->log_weight_table, size * sizeof(Entropy));
+
+		if (superposition->log_weight_table == NULL) {
+			fprintf(stderr, "Failed to allocate memory: get_log_weight_sum()\n");
+			exit(1);
+		}
+
+		// log of zero is never used, entropy of an empty field is zero
+		for (int i = superposition->log_weight_table_size; i < size; i++) {
+			superposition->log_weight_table[i] = i == 0 ? 0 : (int)(logf(i) * ENTROPY_ONE_POINT);
+		}
+
+		superposition->log_weight_table_size = size;
+	}
+
+	return superposition->log_weight_table[weight_sum];
+}
+
+// work out a tile's weight sums from scratch and remember the field they're for
+void initalize_tile_weight_sums(Superposition* superposition, int tile_index) {
+	int tile_field_size = superposition->world->tileset->tile_field_size;
+	BitField tile_field = field_index_array(superposition->fields, tile_field_size, tile_index);
+
+	distribution_area_select(&superposition->selection, superposition->area, superposition->u + get_tile_i(superposition, tile_index), superposition->v + get_tile_j(superposition, tile_index));
+	distribution_selection_get_weight_sums(&superposition->selection, tile_field, &superposition->weight_sums[tile_index], &superposition->weight_log_weight_sums[tile_index]);
+	field_copy(field_index_array(superposition->weighted_fields, tile_field_size, tile_index), tile_field, tile_field_size);
+}
+
+// find entropy of tile giving distribution
+// the weight sums are brought up to date with only the tiles added or removed since they were last updated
+Entropy get_tile_entropy(Superposition* superposition, int tile_index) {
+	int i = get_tile_i(superposition, tile_index), j = get_tile_j(superposition, tile_index);
 
 	// get tile field
 	int tile_field_size = superposition->world->tileset->tile_field_size;
-	int tile_index = i + j * superposition->collapse_width;
 	BitField tile_field = field_index_array(superposition->fields, tile_field_size, tile_index);
+	BitField weighted_field = field_index_array(superposition->weighted_fields, tile_field_size, tile_index);
 
-	// find entropy of tile giving distribution
-	distribution_area_select(superposition->area, superposition->u + i, superposition->v + j);
-	Entropy new_entropy = distribution_area_get_shannon_entropy(tile_field);
+	distribution_area_select(&superposition->selection, superposition->area, superposition->u + i, superposition->v + j);
 
-	entropies_update_entropy(superposition->entropies, i + j * superposition->collapse_width, new_entropy);
+	Entropy weight_sum = superposition->weight_sums[tile_index];
+	Entropy weight_log_weight_sum = superposition->weight_log_weight_sums[tile_index];
 
-	// since this is a map function we should return the value of this node
-	return superposition;
+	for (int frame = 0; frame < bit_field_storage_frame_size(tile_field_size); frame++) {
+		if (!wasm_v128_any_true(wasm_v128_xor(wasm_v128_load(tile_field + frame), wasm_v128_load(weighted_field + frame)))) continue;
+
+		for (int byte = frame * BIT_FIELD_FRAME_SIZE; byte < (frame + 1) * BIT_FIELD_FRAME_SIZE && byte < tile_field_size; byte++) {
+			uint8_t old_byte = field_get_byte(weighted_field, byte), new_byte = field_get_byte(tile_field, byte);
+
+			for (uint8_t changed = old_byte ^ new_byte; changed != 0; changed &= changed - 1) {
+				int bit = __builtin_ctz(changed);
+				Entropy weight, weight_log_weight;
+				distribution_selection_get_tile_weights(&superposition->selection, byte * 8 + bit, &weight, &weight_log_weight);
+
+				if (new_byte & (1 << bit)) {
+					weight_sum += weight;
+					weight_log_weight_sum += weight_log_weight;
+				} else {
+					weight_sum -= weight;
+					weight_log_weight_sum -= weight_log_weight;
+				}
+			}
+		}
+	}
+
+	superposition->weight_sums[tile_index] = weight_sum;
+	superposition->weight_log_weight_sums[tile_index] = weight_log_weight_sum;
+	field_copy(weighted_field, tile_field, tile_field_size);
+
+	return distribution_get_shannon_entropy_from_sums(weight_sum, weight_log_weight_sum, get_log_weight_sum(superposition, weight_sum));
+}
+
+// update the entory for one tile, this will uncollapse it if it was collapsed
+void update_tile_entropy(Superposition* superposition, int tile_index) {
+	entropies_update_entropy(superposition->entropies, tile_index, get_tile_entropy(superposition, tile_index));
+}
+
+// record that entorpy is stale, the update is delayed incase it is done repeatedly in a short time
+void mark_entropy_stale(Superposition* superposition, int tile_index) {
+	if (!superposition->record_entropy_changes) return;
+	dirtyset_add(superposition->stale_entropy_tiles, tile_index);
 }
 
 // update entropy data for recetly changed tiles
 void update_stale_entropies(Superposition* superposition) {
-	hashmap_map(superposition->stale_entropy_tiles, update_stale_entropies_map_func);
+	DirtySet* stale_entropy_tiles = superposition->stale_entropy_tiles;
+
+	entropies_begin_batch(superposition->entropies, stale_entropy_tiles->length);
 
-	// clear hashmap
-	hashmap_clear(superposition->stale_entropy_tiles, 32);
+	for (int i = 0; i < stale_entropy_tiles->length; i++) {
+		int tile_index = stale_entropy_tiles->indices[i];
+		entropies_set_entropy(superposition->entropies, tile_index, get_tile_entropy(superposition, tile_index));
+	}
+
+	entropies_end_batch(superposition->entropies);
+	dirtyset_clear(stale_entropy_tiles);
 }
 
-// collapse tile with least entropy
+// add a tile to the propagation queue, tiles already waiting in the queue aren't added twice
+void queue_propagation(Superposition* superposition, int tile_index) {
+	if (field_get_bit(superposition->queued_tiles, tile_index)) return;
+	field_set_bit(superposition->queued_tiles, tile_index);
 
-void constrain_neighbours(Superposition* superposition, int u, int v, TileEdge skip_edge);
+	int queue_end = (superposition->queue_start + superposition->queue_length) % superposition->tile_capacity;
+	superposition->propagation_queue[queue_end] = tile_index;
+	superposition->queue_length++;
+}
 
-void constrain_field(Superposition* superposition, int i, int j, BitField edge_constraint, int from_edge) {
-	if (i < 0 || j < 0 || i >= superposition->collapse_width || j >= superposition->collapse_height) return;
-	if (entropies_is_collapsed(superposition->entropies, i + j * superposition->collapse_width)) return;
+int dequeue_propagation(Superposition* superposition) {
+	int tile_index = superposition->propagation_queue[superposition->queue_start];
+	field_clear_bit(superposition->queued_tiles, tile_index);
 
-	Tileset* tileset = superposition->world->tileset;
-	BitField tile_field = field_index_array(superposition->fields, tileset->tile_field_size, i + j * superposition->collapse_width);
+	superposition->queue_start = (superposition->queue_start + 1) % superposition->tile_capacity;
+	superposition->queue_length--;
+
+	return tile_index;
+}
+
+void clear_propagation_queue(Superposition* superposition) {
+	while (superposition->queue_length > 0) {
+		dequeue_propagation(superposition);
+	}
+}
+
+// copy the current field of a tile onto the trail before it's changed
+void push_trail(Superposition* superposition, int tile_index) {
+	int tile_field_size = superposition->world->tileset->tile_field_size;
+	const FieldKernels* kernels = superposition->world->tileset->kernels->tile_fields;
+
+	if (superposition->trail_length >= superposition->trail_capacity) {
+		superposition->trail_capacity *= 2;
+		superposition->trail_tiles = realloc_inst(superposition->trail_tiles, superposition->trail_capacity * sizeof(uint32_t));
+		superposition->trail_fields = field_realloc_array(superposition->trail_fields, superposition->trail_capacity, tile_field_size);
+
+		if (superposition->trail_tiles == NULL) {
+			fprintf(stderr, "Failed to allocate memory: push_trail()\n");
+			exit(1);
+		}
+	}
+
+	BitField tile_field = field_index_array(superposition->fields, tile_field_size, tile_index);
+	BitField trail_field = field_index_array(superposition->trail_fields, tile_field_size, superposition->trail_length);
 
-	int inital_pop = field_popcnt(tile_field, tileset->tile_field_size);
-	tileset_constrain_tile(tileset, tile_field, edge_constraint, from_edge);
-	int final_pop = field_popcnt(tile_field, tileset->tile_field_size);
+	kernels->copy(trail_field, tile_field, tile_field_size);
+	superposition->trail_tiles[superposition->trail_length] = tile_index;
+	superposition->trail_length++;
+}
+
+// restore fields from the trail until it's back to trail_start
+void undo_trail(Superposition* superposition, int trail_start) {
+	int tile_field_size = superposition->world->tileset->tile_field_size;
+	const FieldKernels* kernels = superposition->world->tileset->kernels->tile_fields;
+
+	while (superposition->trail_length > trail_start) {
+		superposition->trail_length--;
 
+		int tile_index = superposition->trail_tiles[superposition->trail_length];
+		BitField tile_field = field_index_array(superposition->fields, tile_field_size, tile_index);
+		BitField trail_field = field_index_array(superposition->trail_fields, tile_field_size, superposition->trail_length);
+
+		kernels->copy(tile_field, trail_field, tile_field_size);
+		mark_entropy_stale(superposition, tile_index);
+
+		// restored tiles only gain tiles, their supports catch up when they're next propagated
+		if (superposition->supports_ready)
+			queue_propagation(superposition, tile_index);
+	}
+}
+
+// get ready to change the field of a tile
+void begin_field_change(Superposition* superposition, int tile_index) {
+	// the old field is pushed before we know if it changes, it's popped again if it doesn't
+	if (superposition->record_trail)
+		push_trail(superposition, tile_index);
+}
+
+// changes are the FIELD_CHANGED and FIELD_EMPTY flags returned by whatever changed the field
+void end_field_change(Superposition* superposition, int tile_index, int changes) {
 	// check if there was a change
-	if (inital_pop != final_pop) {
-		// record that entorpy is stale, the update is delayed incase it is done repeatedly in a short time
-		// it's convinent to give a pointer to superposition for later, see update_stale_entropies
-		if (superposition->record_entropy_changes)
-			hashmap_set(superposition->stale_entropy_tiles, hashkey_from_pair(i, j), superposition);
+	if (changes & FIELD_CHANGED) {
+		mark_entropy_stale(superposition, tile_index);
 
-		// propogate change to neighbours
-		constrain_neighbours(superposition, i, j, from_edge);
+		if (changes & FIELD_EMPTY) {
+			// no tile fits here, stop propagating and let the caller deal with it
+			superposition->contradiction = tile_index;
+			return;
+		}
+
+		// propogate change to neighbours later
+		queue_propagation(superposition, tile_index);
+	} else if (superposition->record_trail) {
+		superposition->trail_length--;
 	}
 }
 
-void constrain_neighbours(Superposition* superposition, int i, int j, TileEdge skip_edge) {
+int is_tile_constrainable(Superposition* superposition, int i, int j) {
+	if (i < 0 || j < 0 || i >= superposition->collapse_width || j >= superposition->collapse_height) return 0;
+	return !entropies_is_collapsed(superposition->entropies, get_tile_index(superposition, i, j));
+}
+
+void constrain_field(Superposition* superposition, int i, int j, BitField edge_constraint, TileEdge from_edge) {
+	if (!is_tile_constrainable(superposition, i, j)) return;
+
+	int tile_index = get_tile_index(superposition, i, j);
+	Tileset* tileset = superposition->world->tileset;
+	BitField tile_field = field_index_array(superposition->fields, tileset->tile_field_size, tile_index);
+
+	begin_field_change(superposition, tile_index);
+	int changes = tileset_constrain_tile(tileset, tile_field, edge_constraint, from_edge);
+	end_field_change(superposition, tile_index, changes);
+}
+
+// constrain the neighbours of a tile by all the edges it could have
+void propagate_edges(Superposition* superposition, int tile_index) {
+	Tileset* tileset = superposition->world->tileset;
+	int edge_field_size = tileset->edge_field_size;
+	int i = get_tile_i(superposition, tile_index), j = get_tile_j(superposition, tile_index);
+
+	BitField tile_field = field_index_array(superposition->fields, tileset->tile_field_size, tile_index);
+	tileset_find_tile_edges(tileset, tile_field, superposition->edge_fields);
+
+	constrain_field(superposition, i + 1, j, field_index_array(superposition->edge_fields, edge_field_size, RIGHT), LEFT);
+	constrain_field(superposition, i, j + 1, field_index_array(superposition->edge_fields, edge_field_size, TOP), BOTTOM);
+	constrain_field(superposition, i - 1, j, field_index_array(superposition->edge_fields, edge_field_size, LEFT), RIGHT);
+	constrain_field(superposition, i, j - 1, field_index_array(superposition->edge_fields, edge_field_size, BOTTOM), TOP);
+}
+
+const int direction_i[4] = {1, 0, -1, 0};
+const int direction_j[4] = {0, 1, 0, -1};
+
+// a neighbour lost the last tile with this edge facing us, remove our tiles that needed it
+void remove_unsupported_tiles(Superposition* superposition, int i, int j, TileEdge from_edge, int edge) {
+	if (!is_tile_constrainable(superposition, i, j)) return;
+
+	int tile_index = get_tile_index(superposition, i, j);
+	Tileset* tileset = superposition->world->tileset;
+	BitField tile_field = field_index_array(superposition->fields, tileset->tile_field_size, tile_index);
+
+	begin_field_change(superposition, tile_index);
+	int changes = tileset->kernels->tile_fields->andnot(tile_field, tileset_get_edge_tiles(tileset, from_edge, edge), tileset->tile_field_size);
+	end_field_change(superposition, tile_index, changes);
+}
+
+// update the supports of a tile by the tiles added and removed since they were last counted
+// neighbours are only constrained when an edge loses its last supporting tile, so work is proportional to removals
+void propagate_supports(Superposition* superposition, int tile_index) {
 	Tileset* tileset = superposition->world->tileset;
-	BitField tile_field = field_index_array(superposition->fields, tileset->tile_field_size, i + j * superposition->collapse_width);
+	int edge_count = tileset->edge_field_size * 8;
+	int i = get_tile_i(superposition, tile_index), j = get_tile_j(superposition, tile_index);
+
+	BitField tile_field = field_index_array(superposition->fields, tileset->tile_field_size, tile_index);
+	BitField supported_field = field_index_array(superposition->supported_fields, tileset->tile_field_size, tile_index);
+	uint16_t* supports = superposition->supports + tile_index * 4 * edge_count;
+
+	// count added tiles first so an edge doesn't look unsupported while we're halfway through
+	for (int byte = 0; byte < tileset->tile_field_size; byte++) {
+		uint8_t added = field_get_byte(tile_field, byte) & ~field_get_byte(supported_field, byte);
+
+		for (; added != 0; added &= added - 1) {
+			int tile = byte * 8 + __builtin_ctz(added);
 
-	if (skip_edge != RIGHT) {
-		tileset_find_tile_edge(tileset, tile_field, superposition->temp_edge_field, RIGHT);
-		constrain_field(superposition, i + 1, j, superposition->temp_edge_field, LEFT);
+			for (int direction = 0; direction < 4; direction++) {
+				supports[direction * edge_count + tileset_get_tile_edge(tileset, tile, direction)]++;
+			}
+		}
 	}
 
-	if (skip_edge != TOP) {
-		tileset_find_tile_edge(tileset, tile_field, superposition->temp_edge_field, TOP);
-		constrain_field(superposition, i, j + 1, superposition->temp_edge_field, BOTTOM);
+	for (int byte = 0; byte < tileset->tile_field_size; byte++) {
+		uint8_t removed = field_get_byte(supported_field, byte) & ~field_get_byte(tile_field, byte);
+
+		for (; removed != 0; removed &= removed - 1) {
+			int tile = byte * 8 + __builtin_ctz(removed);
+
+			for (int direction = 0; direction < 4; direction++) {
+				int edge = tileset_get_tile_edge(tileset, tile, direction);
+				if (--supports[direction * edge_count + edge] > 0) continue;
+
+				// the neighbour touches this edge with its opposite edge
+				remove_unsupported_tiles(superposition, i + direction_i[direction], j + direction_j[direction], (direction + 2) % 4, edge);
+			}
+		}
 	}
 
-	if (skip_edge != LEFT) {
-		tileset_find_tile_edge(tileset, tile_field, superposition->temp_edge_field, LEFT);
-		constrain_field(superposition, i - 1, j, superposition->temp_edge_field, RIGHT);
+	field_copy(supported_field, tile_field, tileset->tile_field_size);
+}
+
+int is_past_deadline(double deadline) {
+	return deadline != NO_DEADLINE && emscripten_get_now() >= deadline;
+}
+
+// propagate changes from queued tiles until no more fields change or the deadline passes
+// the queue keeps stack usage flat for any area size, on a contradiction the rest of the queue is left for the caller
+void propagate_until(Superposition* superposition, double deadline) {
+	int steps = 0;
+
+	while (superposition->queue_length > 0) {
+		if (superposition->contradiction != NO_CONTRADICTION) return;
+
+		int tile_index = dequeue_propagation(superposition);
+
+		if (superposition->supports_ready) {
+			propagate_supports(superposition, tile_index);
+		} else {
+			propagate_edges(superposition, tile_index);
+		}
+
+		if (++steps % DEADLINE_CHECK_INTERVAL == 0 && is_past_deadline(deadline)) return;
 	}
+}
+
+void propagate(Superposition* superposition) {
+	propagate_until(superposition, NO_DEADLINE);
+}
+
+// undo decisions until propagation no longer ends in a contradiction
+// the tile picked by each undone decision is banned from its field, this change belongs to the decision before it
+void backtrack(Superposition* superposition) {
+	Tileset* tileset = superposition->world->tileset;
+
+	while (superposition->contradiction != NO_CONTRADICTION) {
+		if (superposition->decision_count == 0 || superposition->backtracks >= superposition->backtrack_limit) {
+			superposition->failed = 1;
+			return;
+		}
+
+		superposition->contradiction = NO_CONTRADICTION;
+		superposition->backtracks++;
+
+		// anything left in the queue is about to be restored, supports still need to see what changed
+		if (!superposition->supports_ready)
+			clear_propagation_queue(superposition);
+
+		Decision decision = superposition->decisions[--superposition->decision_count];
+		int i = get_tile_i(superposition, decision.tile_index), j = get_tile_j(superposition, decision.tile_index);
 
-	if (skip_edge != BOTTOM) {
-		tileset_find_tile_edge(tileset, tile_field, superposition->temp_edge_field, BOTTOM);
-		constrain_field(superposition, i, j - 1, superposition->temp_edge_field, TOP);
+		undo_trail(superposition, decision.trail_start);
+		set_world_tile(superposition, i, j, NULL_TILE);
+
+		// put the tile back in the entropies right away, it must be uncollapsed before it can be constrained again
+		update_tile_entropy(superposition, decision.tile_index);
+
+		BitField tile_field = field_index_array(superposition->fields, tileset->tile_field_size, decision.tile_index);
+		push_trail(superposition, decision.tile_index);
+		field_clear_bit(tile_field, decision.tile_id);
+		mark_entropy_stale(superposition, decision.tile_index);
+
+		if (field_popcnt(tile_field, tileset->tile_field_size) == 0) {
+			superposition->contradiction = decision.tile_index;
+			continue;
+		}
+
+		queue_propagation(superposition, decision.tile_index);
+		propagate(superposition);
 	}
 }
 
+void repair_region(Superposition* superposition);
+int initalize_until(Superposition* superposition, double deadline);
+
+// collapse tile with least entropy
 void collapse_least(Superposition* superposition) {
 	Tileset* tileset = superposition->world->tileset;
 
 	// pick tile with least entropy
 	GenerationTile least_tile = entropies_collapse_least(superposition->entropies);
 
-	int i = least_tile % superposition->collapse_width, j = least_tile / superposition->collapse_width;
+	int i = get_tile_i(superposition, least_tile), j = get_tile_j(superposition, least_tile);
 
 	// get field for tile
-	BitField tile_field = field_index_array(superposition->fields, tileset->tile_field_size, i + j * superposition->collapse_width);
+	BitField tile_field = field_index_array(superposition->fields, tileset->tile_field_size, least_tile);
 
 	// collapse to tile using weighted random
-	distribution_area_select(superposition->area, superposition->u + i, superposition->v + j);
-	int tile_id = distribution_area_pick_random(tile_field);
+	distribution_area_select(&superposition->selection, superposition->area, superposition->u + i, superposition->v + j);
+	int tile_id = distribution_selection_pick_random(&superposition->selection, tile_field, &superposition->random);
+
+	// remember the decision so it can be undone
+	if (superposition->record_trail) {
+		Decision* decision = &superposition->decisions[superposition->decision_count++];
+		decision->trail_start = superposition->trail_length;
+		decision->tile_index = least_tile;
+		decision->tile_id = tile_id;
+
+		push_trail(superposition, least_tile);
+	}
 
 	// update world
-	world_set(superposition->world, superposition->x + superposition->u + i, superposition->y + superposition->v + j, tile_id);
+	set_world_tile(superposition, i, j, tile_id);
 
 	// update field
 	field_clear(tile_field, tileset->tile_field_size);
 	field_set_bit(tile_field, tile_id);
 
 	// propogate change to neighbours
-	constrain_neighbours(superposition, i, j, NONE);
+	queue_propagation(superposition, least_tile);
+	propagate(superposition);
+	superposition->collapses_since_repair++;
+
+	if (superposition->contradiction != NO_CONTRADICTION) {
+		if (superposition->repair_mode == REPAIR_REGION_RESTART) {
+			repair_region(superposition);
+		} else if (superposition->record_trail) {
+			backtrack(superposition);
+		} else {
+			superposition->failed = 1;
+		}
+	}
 
 	// clean up entropies for next pick
 	update_stale_entropies(superposition);
 }
 
 void get_naive_tile_field(Superposition* superposition, int i, int j, BitField tile_field) {
-	int tile_id = world_get(superposition->world, superposition->x + superposition->u + i, superposition->y + superposition->v + j);
+	int tile_id = get_world_tile(superposition, i, j);
 	Tileset* tileset = superposition->world->tileset;
 
 	if (tile_id == NULL_TILE) {
-		distribution_area_select(superposition->area, superposition->u + i, superposition->u + j);
-		distribution_area_get_all_tiles(tile_field, tileset->tile_field_size);
+		distribution_area_select(&superposition->selection, superposition->area, superposition->u + i, superposition->v + j);
+		distribution_selection_get_all_tiles(&superposition->selection, tile_field, tileset->tile_field_size);
 	} else {
 		field_clear(tile_field, tileset->tile_field_size);
 		field_set_bit(tile_field, tile_id);
@@ -142,93 +486,418 @@ void get_naive_tile_field(Superposition* superposition, int i, int j, BitField t
 }
 
 int superposition_collapse_tiles(Superposition* superposition, int amount) {
+	initalize_until(superposition, NO_DEADLINE);
+
 	for (int i = 0; i < amount; i++) {
-		if (superposition->entropies->heap_size <= 0) return 1;
+		if (superposition->failed) return COLLAPSE_FAILED;
+		if (superposition->entropies->heap_size <= 0) return COLLAPSE_FINISHED;
 		collapse_least(superposition);
 	}
 
-	return 0;
+	return superposition->failed ? COLLAPSE_FAILED : COLLAPSE_UNFINISHED;
 }
 
-void superposition_select_collapse_area(Superposition* superposition, int u, int v, int width, int height) {
+// initalize and collapse the area for about budget_us microseconds, call again to carry on where it stopped
+// a single collapse isn't split up, so one with a deep propagation can run over the budget
+int superposition_collapse_for(Superposition* superposition, int budget_us) {
+	double deadline = emscripten_get_now() + budget_us / 1000.0;
+
+	if (!initalize_until(superposition, deadline)) return COLLAPSE_UNFINISHED;
+
+	do {
+		if (superposition->failed) return COLLAPSE_FAILED;
+		if (superposition->entropies->heap_size <= 0) return COLLAPSE_FINISHED;
+		collapse_least(superposition);
+	} while (!is_past_deadline(deadline));
+
+	return superposition->failed ? COLLAPSE_FAILED : COLLAPSE_UNFINISHED;
+}
+
+InitPhase superposition_get_init_phase(Superposition* superposition) {
+	return superposition->init_phase;
+}
+
+// tiles left to collapse, every tile in the area counts until initalization is done
+int superposition_get_remaining(Superposition* superposition) {
+	if (superposition->init_phase != INIT_DONE) return superposition->collapse_width * superposition->collapse_height;
+	return superposition->entropies->heap_size;
+}
+
+void superposition_set_backtrack_limit(Superposition* superposition, int limit) {
+	superposition->backtrack_limit = limit;
+}
+
+int superposition_get_backtracks(Superposition* superposition) {
+	return superposition->backtracks;
+}
+
+int superposition_get_decision_depth(Superposition* superposition) {
+	return superposition->decision_count;
+}
+
+// takes effect from the next collapse area
+void superposition_set_repair_mode(Superposition* superposition, RepairMode mode) {
+	superposition->repair_mode = mode;
+}
+
+int superposition_get_repairs(Superposition* superposition) {
+	return superposition->repairs;
+}
+
+// takes effect from the next collapse area
+void superposition_set_entropy_queue(Superposition* superposition, EntropyQueue queue) {
+	superposition->entropy_queue = queue;
+}
+
+// takes effect from the next collapse area, that's also when the support counts get their memory
+void superposition_set_propagation_engine(Superposition* superposition, PropagationEngine engine) {
+	superposition->propagation_engine = engine;
+}
+
+// constrain a tile on the edge of the collapse area by an already collapsed tile outside of it
+void constrain_field_by_world(Superposition* superposition, int i, int j, int outside_i, int outside_j, TileEdge from_edge) {
+	int tile_id = get_world_tile(superposition, outside_i, outside_j);
+	if (tile_id == NULL_TILE) return;  // nothing to constrain against yet
+
+	Tileset* tileset = superposition->world->tileset;
+
+	field_clear(superposition->temp_tile_field, tileset->tile_field_size);
+	field_set_bit(superposition->temp_tile_field, tile_id);
+	tileset_find_tile_edges(tileset, superposition->temp_tile_field, superposition->edge_fields);
+
+	// the outside tile touches this one with its opposite edge
+	TileEdge outside_edge = (from_edge + 2) % 4;
+	constrain_field(superposition, i, j, field_index_array(superposition->edge_fields, tileset->edge_field_size, outside_edge), from_edge);
+}
+
+// reset a window of tiles around a contradiction to their naive fields and propagate back into it from the window's border
+// the window grows while contradictions keep happening inside the last one, so a failure costs O(r²) instead of the whole area
+void repair_region(Superposition* superposition) {
+	Tileset* tileset = superposition->world->tileset;
+	int width = superposition->collapse_width, height = superposition->collapse_height;
+
+	int resetting = 0;
+
+	while (superposition->contradiction != NO_CONTRADICTION) {
+		int contradiction_i = get_tile_i(superposition, superposition->contradiction), contradiction_j = get_tile_j(superposition, superposition->contradiction);
+		int radius = superposition->repair_radius;
+		int window_covers_area = radius >= width && radius >= height;
+
+		// propagating into a reset of the whole area failed, no collapse can fix that
+		if (resetting && window_covers_area) {
+			superposition->failed = 1;
+			return;
+		}
+
+		if (superposition->repairs >= superposition->backtrack_limit) {
+			superposition->failed = 1;
+			return;
+		}
+
+		// grow the window if we failed inside the last one, or the ring around it, before it was collapsed again
+		int window_width = 2 * radius + 1;
+		int is_repeated = superposition->repairs > 0 && superposition->collapses_since_repair < window_width * window_width &&
+						  abs(contradiction_i - superposition->repair_i) <= radius + 1 && abs(contradiction_j - superposition->repair_j) <= radius + 1;
+
+		if (is_repeated) {
+			if (!window_covers_area) superposition->repair_radius *= 2;
+		} else {
+			superposition->repair_radius = REPAIR_RADIUS;
+			superposition->repair_i = contradiction_i;
+			superposition->repair_j = contradiction_j;
+		}
+
+		resetting = 1;
+		superposition->collapses_since_repair = 0;
+		// the rest of the queue is left in, changes outside the window still need propagating
+		superposition->contradiction = NO_CONTRADICTION;
+		superposition->repairs++;
+
+		radius = superposition->repair_radius;
+		int start_i = superposition->repair_i - radius < 0 ? 0 : superposition->repair_i - radius;
+		int start_j = superposition->repair_j - radius < 0 ? 0 : superposition->repair_j - radius;
+		int end_i = superposition->repair_i + radius >= width ? width - 1 : superposition->repair_i + radius;
+		int end_j = superposition->repair_j + radius >= height ? height - 1 : superposition->repair_j + radius;
+
+		// reset the window, tiles must be uncollapsed before they can be constrained again
+		for (int j = start_j; j <= end_j; j++) {
+			for (int i = start_i; i <= end_i; i++) {
+				int tile_index = get_tile_index(superposition, i, j);
+				if (field_get_bit(superposition->pinned_tiles, tile_index)) continue;
+
+				set_world_tile(superposition, i, j, NULL_TILE);
+				get_naive_tile_field(superposition, i, j, field_index_array(superposition->fields, tileset->tile_field_size, tile_index));
+				update_tile_entropy(superposition, tile_index);
+
+				// the reset only adds tiles, count them before anything is removed again
+				if (superposition->supports_ready)
+					propagate_supports(superposition, tile_index);
+			}
+		}
+
+		// the area's own edges are still constrained by the world outside it
+		for (int i = start_i; i <= end_i; i++) {
+			if (start_j == 0) constrain_field_by_world(superposition, i, 0, i, -1, BOTTOM);
+			if (end_j == height - 1) constrain_field_by_world(superposition, i, height - 1, i, height, TOP);
+		}
+
+		for (int j = start_j; j <= end_j; j++) {
+			if (start_i == 0) constrain_field_by_world(superposition, 0, j, -1, j, LEFT);
+			if (end_i == width - 1) constrain_field_by_world(superposition, width - 1, j, width, j, RIGHT);
+		}
+
+		// propagate from the window and the ring of tiles around it
+		// supports only act on removals, so the widened window is constrained by the table once
+		for (int j = start_j - 1; j <= end_j + 1; j++) {
+			for (int i = start_i - 1; i <= end_i + 1; i++) {
+				if (i < 0 || j < 0 || i >= width || j >= height) continue;
+				if (superposition->contradiction != NO_CONTRADICTION) break;
+
+				if (superposition->supports_ready) {
+					propagate_edges(superposition, get_tile_index(superposition, i, j));
+				} else {
+					queue_propagation(superposition, get_tile_index(superposition, i, j));
+				}
+			}
+		}
+
+		propagate(superposition);
+	}
+}
+
+// lay out every per tile buffer in the tile arena, only done when the arena has to grow
+// buffers stay where they are between collapse areas, so areas no bigger than the largest so far allocate nothing
+void reserve_tile_buffers(Superposition* superposition, int tile_count) {
+	int needs_supports = superposition->propagation_engine == PROPAGATION_SUPPORT && superposition->supports == NULL;
+	if (tile_count <= superposition->tile_capacity && !needs_supports) return;
+
+	Tileset* tileset = superposition->world->tileset;
+	int capacity = tile_count > superposition->tile_capacity ? tile_count : superposition->tile_capacity;
+	int with_supports = superposition->propagation_engine == PROPAGATION_SUPPORT || superposition->supports != NULL;
+
+	int fields_size = capacity * bit_field_storage_frame_size(tileset->tile_field_size) * BIT_FIELD_FRAME_SIZE;
+	int supports_size = capacity * 4 * tileset->edge_field_size * 8 * sizeof(uint16_t);
+	int bitmap_size = (capacity + 7) / 8;
+
+	size_t size = arena_aligned_size(fields_size) * 2 + arena_aligned_size(capacity * sizeof(Entropy)) * 2 + entropies_get_arena_size(capacity) + dirtyset_get_arena_size(capacity);
+	size += arena_aligned_size(capacity * sizeof(uint32_t)) + arena_aligned_size(bitmap_size) * 2 + arena_aligned_size(capacity * sizeof(Decision));
+	if (with_supports) size += arena_aligned_size(supports_size) + arena_aligned_size(fields_size);
+
+	Arena* arena = superposition->tile_arena;
+	arena_reserve(arena, size);
+
+	superposition->fields = arena_alloc(arena, fields_size);
+	superposition->weighted_fields = arena_alloc(arena, fields_size);
+	superposition->weight_sums = arena_alloc(arena, capacity * sizeof(Entropy));
+	superposition->weight_log_weight_sums = arena_alloc(arena, capacity * sizeof(Entropy));
+	entropies_allocate(superposition->entropies, arena, capacity);
+	dirtyset_allocate(superposition->stale_entropy_tiles, arena, capacity);
+	superposition->propagation_queue = arena_alloc(arena, capacity * sizeof(uint32_t));
+	superposition->queued_tiles = arena_alloc(arena, bitmap_size);
+	superposition->pinned_tiles = arena_alloc(arena, bitmap_size);
+	superposition->decisions = arena_alloc(arena, capacity * sizeof(Decision));
+
+	if (with_supports) {
+		superposition->supports = arena_alloc(arena, supports_size);
+		superposition->supported_fields = arena_alloc(arena, fields_size);
+	}
+
+	// the layout only changes when it gets bigger, so the bitmaps always start out in freshly zeroed memory
+	// after that they're left clean by whatever used them
+	superposition->tile_capacity = capacity;
+	superposition->queue_start = 0;
+}
+
+// get the area ready to initalize, no work is done until superposition_collapse_for or superposition_collapse_tiles
+void superposition_begin_collapse_area(Superposition* superposition, int u, int v, int width, int height) {
 	superposition->u = u;
 	superposition->v = v;
 	superposition->collapse_width = width;
 	superposition->collapse_height = height;
+	superposition->blocks_width = (width + TILE_BLOCK_SIZE - 1) >> TILE_BLOCK_BITS;
+	superposition->tile_count = superposition->blocks_width * ((height + TILE_BLOCK_SIZE - 1) >> TILE_BLOCK_BITS) << (2 * TILE_BLOCK_BITS);
 
-	Tileset* tileset = superposition->world->tileset;
-	superposition->fields = field_create_empty_array(width * height, tileset->tile_field_size);
+	// the queue and stale set have to be emptied before their buffers can move
+	clear_propagation_queue(superposition);
+	dirtyset_clear(superposition->stale_entropy_tiles);
+	reserve_tile_buffers(superposition, superposition->tile_count);
+
+	// the distribution area may have been refilled since the last collapse area
+	distribution_selection_clear(&superposition->selection);
 
-	// disable entropy while we construct the inital feilds
+	// the area and the border around it, so tiles are read and written without looking their chunk up each time
+	world_select_chunk_window(superposition->world, &superposition->chunks, superposition->x + u - 1, superposition->y + v - 1, width + 2, height + 2);
+
+	// an area always rolls the same numbers, so it generates the same way whenever it's generated
+	random_stream_seed(&superposition->random, superposition->world->seed, superposition->x + u, superposition->y + v);
+
+	// disable entropy and the trail while we construct the inital feilds
 	superposition->record_entropy_changes = 0;
+	superposition->record_trail = 0;
+
+	superposition->contradiction = NO_CONTRADICTION;
+	superposition->failed = 0;
+	superposition->trail_length = 0;
+	superposition->decision_count = 0;
+	superposition->backtracks = 0;
+	superposition->repairs = 0;
+	superposition->supports_ready = 0;
+	field_clear(superposition->pinned_tiles, (superposition->tile_capacity + 7) / 8);
+
+	superposition->init_phase = INIT_NAIVE_FIELDS;
+	superposition->init_cursor = 0;
+}
 
-	// get naive values for each tile feild
-	for (int i = 0; i < width; i++) {
-		for (int j = 0; j < height; j++) {
-			BitField tile_field = field_index_array(superposition->fields, tileset->tile_field_size, i + j * width);
-			get_naive_tile_field(superposition, i, j, tile_field);
+// run the init phases until they're done or the deadline passes, returns whether they're done
+// every phase does a little work before checking the deadline so each call makes progress
+int initalize_until(Superposition* superposition, double deadline) {
+	Tileset* tileset = superposition->world->tileset;
+	int width = superposition->collapse_width, height = superposition->collapse_height;
+	int tile_count = superposition->tile_count;
+
+	// get naive values for each tile feild, tiles already in the world are marked collapsed so they stay fixed
+	// so are the tiles past the area, they're left out of everything after this
+	for (; superposition->init_phase == INIT_NAIVE_FIELDS && superposition->init_cursor < tile_count; superposition->init_cursor++) {
+		int tile_index = superposition->init_cursor;
+		int i = get_tile_i(superposition, tile_index), j = get_tile_j(superposition, tile_index);
+
+		if (!is_tile_in_area(superposition, i, j)) {
+			superposition->entropies->tiles[tile_index] = COLLAPSED_ENTROPY;
+			continue;
 		}
-	}
 
-	// contrain tiles baced off horizontal edges
-	for (int i = 0; i < width; i++) {
-		get_naive_tile_field(superposition, i, 0, superposition->temp_tile_field);
-		tileset_find_tile_edge(tileset, superposition->temp_tile_field, superposition->temp_edge_field, TOP);
-		constrain_field(superposition, i, 0, superposition->temp_edge_field, BOTTOM);
+		BitField tile_field = field_index_array(superposition->fields, tileset->tile_field_size, tile_index);
+		get_naive_tile_field(superposition, i, j, tile_field);
 
-		get_naive_tile_field(superposition, i, height - 1, superposition->temp_tile_field);
-		tileset_find_tile_edge(tileset, superposition->temp_tile_field, superposition->temp_edge_field, BOTTOM);
-		constrain_field(superposition, i, height - 1, superposition->temp_edge_field, TOP);
-	}
+		int tile_id = get_world_tile(superposition, i, j);
+		if (tile_id == NULL_TILE) {
+			superposition->entropies->tiles[tile_index] = 0;
+		} else {
+			superposition->entropies->tiles[tile_index] = COLLAPSED_ENTROPY;
+			field_set_bit(superposition->pinned_tiles, tile_index);
+		}
 
-	// contrain tiles baced off vertical edges
-	for (int j = 0; j < height; j++) {
-		get_naive_tile_field(superposition, 0, j, superposition->temp_tile_field);
-		tileset_find_tile_edge(tileset, superposition->temp_tile_field, superposition->temp_edge_field, RIGHT);
-		constrain_field(superposition, 0, j, superposition->temp_edge_field, LEFT);
+		if ((tile_index + 1) % DEADLINE_CHECK_INTERVAL == 0 && is_past_deadline(deadline)) {
+			superposition->init_cursor++;
+			return 0;
+		}
+	}
 
-		get_naive_tile_field(superposition, width - 1, j, superposition->temp_tile_field);
-		tileset_find_tile_edge(tileset, superposition->temp_tile_field, superposition->temp_edge_field, LEFT);
-		constrain_field(superposition, width - 1, j, superposition->temp_edge_field, RIGHT);
+	if (superposition->init_phase == INIT_NAIVE_FIELDS) {
+		superposition->init_phase = INIT_BORDERS;
+		superposition->init_cursor = 0;
 	}
 
-	// contrain tiles baced off eachother
-	for (int j = 0; j < height; j++) {
+	// borders only touch the edge of the area so they're done in one go
+	if (superposition->init_phase == INIT_BORDERS) {
+		// contrain tiles baced off horizontal edges
 		for (int i = 0; i < width; i++) {
-			constrain_neighbours(superposition, i, j, NONE);
+			constrain_field_by_world(superposition, i, 0, i, -1, BOTTOM);
+			constrain_field_by_world(superposition, i, height - 1, i, height, TOP);
 		}
-	}
 
-	// calculate entropies for each tile
-	for (int i = 0; i < width; i++) {
+		// contrain tiles baced off vertical edges
+		for (int j = 0; j < height; j++) {
+			constrain_field_by_world(superposition, 0, j, -1, j, LEFT);
+			constrain_field_by_world(superposition, width - 1, j, width, j, RIGHT);
+		}
+
+		// contrain tiles baced off eachother
 		for (int j = 0; j < height; j++) {
-			int tile_id = world_get(superposition->world, superposition->x + u + i, superposition->y + v + j);
+			for (int i = 0; i < width; i++) {
+				queue_propagation(superposition, get_tile_index(superposition, i, j));
+			}
+		}
+
+		superposition->init_phase = INIT_PROPAGATE;
+		if (is_past_deadline(deadline)) return 0;
+	}
+
+	if (superposition->init_phase == INIT_PROPAGATE) {
+		propagate_until(superposition, deadline);
+
+		// there is nothing to backtrack to yet, the area can't be collapsed
+		if (superposition->contradiction != NO_CONTRADICTION) {
+			superposition->failed = 1;
+			clear_propagation_queue(superposition);
+		}
+
+		if (superposition->queue_length > 0) return 0;
 
-			if (tile_id != NULL_TILE) {
-				// already collapsed, skip entropy calculation
-				superposition->entropies->tiles[i + j * width] = COLLAPSED_ENTROPY;
-				continue;
+		superposition->init_phase = INIT_SUPPORTS;
+		superposition->init_cursor = 0;
+	}
+
+	// the support engine takes over from the inital fields, supports are counted from scratch
+	if (superposition->init_phase == INIT_SUPPORTS && superposition->propagation_engine == PROPAGATION_SUPPORT && superposition->supports != NULL) {
+		if (superposition->init_cursor == 0)
+			memset(superposition->supports, 0, tile_count * 4 * tileset->edge_field_size * 8 * sizeof(uint16_t));
+
+		for (; superposition->init_cursor < tile_count; superposition->init_cursor++) {
+			int tile_index = superposition->init_cursor;
+			field_clear(field_index_array(superposition->supported_fields, tileset->tile_field_size, tile_index), tileset->tile_field_size);
+			if (is_tile_in_area(superposition, get_tile_i(superposition, tile_index), get_tile_j(superposition, tile_index)))
+				propagate_supports(superposition, tile_index);
+
+			if ((tile_index + 1) % DEADLINE_CHECK_INTERVAL == 0 && is_past_deadline(deadline)) {
+				superposition->init_cursor++;
+				return 0;
 			}
+		}
+
+		superposition->supports_ready = 1;
+	}
 
-			BitField tile_field = field_index_array(superposition->fields, tileset->tile_field_size, i + j * width);
+	if (superposition->init_phase == INIT_SUPPORTS) {
+		superposition->init_phase = INIT_ENTROPIES;
+		superposition->init_cursor = 0;
+	}
+
+	// calculate entropies for each tile
+	for (; superposition->init_phase == INIT_ENTROPIES && superposition->init_cursor < tile_count; superposition->init_cursor++) {
+		int tile_index = superposition->init_cursor;
+		if (!is_tile_in_area(superposition, get_tile_i(superposition, tile_index), get_tile_j(superposition, tile_index))) continue;
+
+		// tiles already in the world get sums too, but stay collapsed
+		initalize_tile_weight_sums(superposition, tile_index);
+		if (superposition->entropies->tiles[tile_index] == COLLAPSED_ENTROPY) continue;
 
-			distribution_area_select(superposition->area, u + i, v + j);
-			Entropy entropy = distribution_area_get_shannon_entropy(tile_field);
+		Entropy weight_sum = superposition->weight_sums[tile_index];
+		superposition->entropies->tiles[tile_index] = distribution_get_shannon_entropy_from_sums(weight_sum, superposition->weight_log_weight_sums[tile_index], get_log_weight_sum(superposition, weight_sum));
 
-			superposition->entropies->tiles[i + j * width] = entropy;
+		if ((tile_index + 1) % DEADLINE_CHECK_INTERVAL == 0 && is_past_deadline(deadline)) {
+			superposition->init_cursor++;
+			return 0;
 		}
 	}
 
-	entropies_initalize_from_tiles(superposition->entropies, width, height);
+	if (superposition->init_phase == INIT_ENTROPIES) {
+		superposition->entropies->queue = superposition->entropy_queue;
+		entropies_initalize_from_tiles(superposition->entropies, width, height, tile_count);
 
-	hashmap_clear(superposition->stale_entropy_tiles, 32);
-	superposition->record_entropy_changes = 1;
+		dirtyset_clear(superposition->stale_entropy_tiles);
+		superposition->record_entropy_changes = 1;
+		superposition->record_trail = superposition->repair_mode == REPAIR_BACKTRACK && superposition->backtrack_limit > 0;
+
+		superposition->init_phase = INIT_DONE;
+	}
+
+	return 1;
+}
+
+void superposition_select_collapse_area(Superposition* superposition, int u, int v, int width, int height) {
+	superposition_begin_collapse_area(superposition, u, v, width, height);
+	initalize_until(superposition, NO_DEADLINE);
 }
 
 void superposition_select_distribution_area(Superposition* superposition, int x, int y, DistributionArea* area) {
 	superposition->x = x;
 	superposition->y = y;
 	superposition->area = area;
+	distribution_selection_clear(&superposition->selection);
+
+	// built here rather than on the first select so areas can be shared by superpositions on other threads
+	distribution_area_build_cache(area);
 }
 
 Superposition* superposition_create(World* world) {
@@ -240,11 +909,51 @@ Superposition* superposition_create(World* world) {
 	}
 
 	superposition->world = world;
-	superposition->entropies = entropies_create(world->chunk_size, world->chunk_size);
-	superposition->stale_entropy_tiles = hashmap_create(32);
+	superposition->area = NULL;
+	distribution_selection_clear(&superposition->selection);
+	superposition->entropies = entropies_create();
 
-	superposition->temp_edge_field = field_create(world->tileset->edge_field_size);
+	superposition->edge_fields = field_create_empty_array(4, world->tileset->edge_field_size);
 	superposition->temp_tile_field = field_create(world->tileset->tile_field_size);
 
+	superposition->stale_entropy_tiles = dirtyset_create();
+
+	// per tile buffers are sized by the largest collapse area, see reserve_tile_buffers
+	// each tile is queued at most once and decisions can't outnumber the tiles, so neither outgrows it
+	superposition->tile_arena = arena_create();
+	superposition->tile_capacity = 0;
+	superposition->fields = NULL;
+	superposition->propagation_queue = NULL;
+	superposition->queued_tiles = NULL;
+	superposition->decisions = NULL;
+	superposition->queue_start = 0;
+	superposition->queue_length = 0;
+
+	// the trail grows as needed and keeps its size
+	superposition->trail_capacity = world->chunk_size * world->chunk_size;
+	superposition->trail_tiles = malloc_inst(superposition->trail_capacity * sizeof(uint32_t));
+	superposition->trail_fields = field_create_junk_array(superposition->trail_capacity, world->tileset->tile_field_size);
+	superposition->backtrack_limit = DEFAULT_BACKTRACK_LIMIT;
+	superposition->repair_mode = REPAIR_BACKTRACK;
+	superposition->propagation_engine = PROPAGATION_TABLE;
+	superposition->entropy_queue = ENTROPY_QUEUE_HEAP;
+	superposition->log_weight_table = NULL;
+	superposition->log_weight_table_size = 0;
+	superposition->supports = NULL;
+	superposition->supported_fields = NULL;
+	superposition->supports_ready = 0;
+	superposition->init_phase = INIT_DONE;
+	superposition->collapse_width = 0;
+	superposition->collapse_height = 0;
+	superposition->blocks_width = 0;
+	superposition->tile_count = 0;
+	superposition->pinned_tiles = NULL;
+	chunk_window_init(&superposition->chunks);
+
+	if (superposition->trail_tiles == NULL) {
+		fprintf(stderr, "Failed to allocate memory: superposition_create()\n");
+		exit(1);
+	}
+
 	return superposition;
 }
\ No newline at end of file
@@ -1,31 +1,116 @@
 #ifndef SUPERPOSITION_GUARD
 #define SUPERPOSITION_GUARD
 
-#include <emscripten.h>
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "arena.h"
 #include "bitfield.h"
+#include "dirtyset.h"
 #include "distribution.h"
 #include "entropies.h"
-#include "hashmap.h"
 #include "meminst.h"
+#include "platform.h"
+#include "random.h"
 #include "world.h"
 
-#define STALE_TILE_LIMIT 256
+#define DEFAULT_BACKTRACK_LIMIT 1024
+#define NO_CONTRADICTION -1
+#define REPAIR_RADIUS 2
+#define NO_DEADLINE INFINITY
+#define DEADLINE_CHECK_INTERVAL 64	// units of work between reading the clock
+
+#define LOG_WEIGHT_TABLE_LIMIT 65536  // weight sums past this call logf instead of growing the table
+
+// tiles of a collapse area are stored in square blocks so neighbours above and below stay close in memory
+#define TILE_BLOCK_BITS 3
+#define TILE_BLOCK_SIZE (1 << TILE_BLOCK_BITS)
+
+// return values of superposition_collapse_tiles and superposition_collapse_for
+#define COLLAPSE_UNFINISHED 0
+#define COLLAPSE_FINISHED 1
+#define COLLAPSE_FAILED -1
+
+// how a contradiction found while collapsing is repaired
+typedef enum {
+	REPAIR_BACKTRACK,		 // undo decisions from the trail
+	REPAIR_REGION_RESTART	 // reset a window of tiles around the contradiction
+} RepairMode;
+
+// how changes to a field are propagated to its neighbours
+typedef enum {
+	PROPAGATION_TABLE,	 // combine the tile table rows of the neighbour's edges
+	PROPAGATION_SUPPORT	 // count supporting tiles for each edge and only act on removals
+} PropagationEngine;
+
+// steps of initalizing a collapse area, each can be paused and resumed at init_cursor
+typedef enum {
+	INIT_NAIVE_FIELDS,
+	INIT_BORDERS,
+	INIT_PROPAGATE,
+	INIT_SUPPORTS,
+	INIT_ENTROPIES,
+	INIT_DONE
+} InitPhase;
+
+// a tile picked while collapsing, remembers where its changes start on the trail so they can be undone
+typedef struct {
+	int trail_start;
+	int tile_index;
+	int tile_id;
+} Decision;
 
 typedef struct {
 	DistributionArea* area;
 	World* world;
 
 	BitField temp_tile_field;
-	BitField temp_edge_field;
+	BitField edge_fields;  // edges of the tile being propagated, one field per direction
 	BitField fields;
 	Entropies* entropies;
-	Hashmap* stale_entropy_tiles;
+	DirtySet* stale_entropy_tiles;
 	int record_entropy_changes;
 
+	// queue of tiles with changed fields that need to be propagated to their neighbours
+	uint32_t* propagation_queue;
+	BitField queued_tiles;
+	int queue_start;
+	int queue_length;
+	int tile_capacity;
+
+	// undo trail, holds the old field of every change made since the first decision
+	uint32_t* trail_tiles;
+	BitField trail_fields;
+	int trail_length;
+	int trail_capacity;
+	int record_trail;
+
+	Decision* decisions;
+	int decision_count;
+	int backtrack_limit;  // also limits region restarts
+	int backtracks;
+	int contradiction;	// tile emptied by propagation, or NO_CONTRADICTION
+	int failed;
+
+	// region restart repair, see repair_region
+	RepairMode repair_mode;
+	BitField pinned_tiles;	// tiles already in the world before collapsing, these are never reset
+	int repair_radius;
+	int repair_i;
+	int repair_j;
+	int collapses_since_repair;
+	int repairs;
+
+	// support counting propagation, see propagate_supports
+	PropagationEngine propagation_engine;
+	uint16_t* supports;	 // tiles in each field with an edge, indexed by tile, direction then edge
+	BitField supported_fields;	// fields as they were when their supports were last counted
+	int supports_ready;
+
+	InitPhase init_phase;
+	int init_cursor;
+
 	// location of distribution area in world
 	int x;
 	int y;
@@ -36,12 +121,40 @@ typedef struct {
 	int collapse_width;
 	int collapse_height;
 
+	Arena* tile_arena;	// holds fields, entropies, the stale entropy set and everything else sized by tile_capacity
+	RandomStream random;  // keyed by the world seed and the collapse area's position in the world
+	DistributionSelection selection;  // distributions at the last tile looked at
+
+	EntropyQueue entropy_queue;	 // given to the entropies when a collapse area is initalized
+
+	// running sums each tile's entropy is worked out from, see get_tile_entropy
+	BitField weighted_fields;  // fields as they were when their sums were last updated
+	Entropy* weight_sums;
+	Entropy* weight_log_weight_sums;
+	Entropy* log_weight_table;	// fixed point log of each weight sum seen so far
+	int log_weight_table_size;
+
+	int blocks_width;  // tile blocks across the collapse area
+	int tile_count;	   // tiles in the collapse area's blocks, the blocks on the right and top edges can reach past it
+
+	ChunkWindow chunks;	 // chunks under the collapse area and its border
 } Superposition;
 
 extern EMSCRIPTEN_KEEPALIVE Superposition* superposition_create(World* world);
 extern EMSCRIPTEN_KEEPALIVE void superposition_select_distribution_area(Superposition* superposition, int x, int y, DistributionArea* area);
 extern EMSCRIPTEN_KEEPALIVE void superposition_select_collapse_area(Superposition* superposition, int u, int v, int width, int height);
+extern EMSCRIPTEN_KEEPALIVE void superposition_begin_collapse_area(Superposition* superposition, int u, int v, int width, int height);
 extern EMSCRIPTEN_KEEPALIVE int superposition_collapse_tiles(Superposition* superposition, int amount);
+extern EMSCRIPTEN_KEEPALIVE int superposition_collapse_for(Superposition* superposition, int budget_us);
+extern EMSCRIPTEN_KEEPALIVE InitPhase superposition_get_init_phase(Superposition* superposition);
+extern EMSCRIPTEN_KEEPALIVE int superposition_get_remaining(Superposition* superposition);
+extern EMSCRIPTEN_KEEPALIVE void superposition_set_backtrack_limit(Superposition* superposition, int limit);
+extern EMSCRIPTEN_KEEPALIVE int superposition_get_backtracks(Superposition* superposition);
+extern EMSCRIPTEN_KEEPALIVE int superposition_get_decision_depth(Superposition* superposition);
+extern EMSCRIPTEN_KEEPALIVE void superposition_set_repair_mode(Superposition* superposition, RepairMode mode);
+extern EMSCRIPTEN_KEEPALIVE int superposition_get_repairs(Superposition* superposition);
+extern EMSCRIPTEN_KEEPALIVE void superposition_set_propagation_engine(Superposition* superposition, PropagationEngine engine);
+extern EMSCRIPTEN_KEEPALIVE void superposition_set_entropy_queue(Superposition* superposition, EntropyQueue queue);
 extern EMSCRIPTEN_KEEPALIVE void superposition_free(Superposition* superposition);
 
 #endif
\ No newline at end of file
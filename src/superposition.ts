@@ -1,11 +1,25 @@
+import { heap32 } from "./cwrapper";
 import { Distribution, DistributionArea } from "./distribution";
+import { freeInst, mallocInst } from "./meminst";
 import { DistributionWorld, World } from "./world";
 
 let superposition_create: (world: number) => number;
 let superposition_select_distribution_area: (superposition: number, x: number, y: number, area: number) => void;
 let superposition_select_collapse_area: (superposition: number, u: number, v: number, width: number, height: number) => void;
+let superposition_begin_collapse_area: (superposition: number, u: number, v: number, width: number, height: number) => void;
 let superposition_collapse_tiles: (superposition: number, amount: number) => number;
+let superposition_collapse_for: (superposition: number, budgetUs: number) => number;
+let superposition_get_init_phase: (superposition: number) => number;
+let superposition_get_remaining: (superposition: number) => number;
+let superposition_set_backtrack_limit: (superposition: number, limit: number) => void;
+let superposition_get_backtracks: (superposition: number) => number;
+let superposition_get_decision_depth: (superposition: number) => number;
+let superposition_set_repair_mode: (superposition: number, mode: number) => void;
+let superposition_get_repairs: (superposition: number) => number;
+let superposition_set_propagation_engine: (superposition: number, engine: number) => void;
+let superposition_set_entropy_queue: (superposition: number, queue: number) => void;
 let superposition_free: (superposition: number) => void;
+let world_generate_chunks: (world: number, chunkCoords: number, chunkCount: number, superposition: number, sourceWorld: number, tileDistributions: number, distributionSize: number) => number;
 
 const superpositionRegistry = new FinalizationRegistry((ptr: number) => {
     superposition_free(ptr);
@@ -15,8 +29,50 @@ export function init() {
     superposition_create = cwrap("superposition_create", "number", ["number"]);
     superposition_select_distribution_area = cwrap("superposition_select_distribution_area", null, ["number", "number", "number", "number"]);
     superposition_select_collapse_area = cwrap("superposition_select_collapse_area", null, ["number", "number", "number", "number", "number"]);
+    superposition_begin_collapse_area = cwrap("superposition_begin_collapse_area", null, ["number", "number", "number", "number", "number"]);
     superposition_collapse_tiles = cwrap("superposition_collapse_tiles", "number", ["number", "number"]);
+    superposition_collapse_for = cwrap("superposition_collapse_for", "number", ["number", "number"]);
+    superposition_get_init_phase = cwrap("superposition_get_init_phase", "number", ["number"]);
+    superposition_get_remaining = cwrap("superposition_get_remaining", "number", ["number"]);
+    superposition_set_backtrack_limit = cwrap("superposition_set_backtrack_limit", null, ["number", "number"]);
+    superposition_get_backtracks = cwrap("superposition_get_backtracks", "number", ["number"]);
+    superposition_get_decision_depth = cwrap("superposition_get_decision_depth", "number", ["number"]);
+    superposition_set_repair_mode = cwrap("superposition_set_repair_mode", null, ["number", "number"]);
+    superposition_get_repairs = cwrap("superposition_get_repairs", "number", ["number"]);
+    superposition_set_propagation_engine = cwrap("superposition_set_propagation_engine", null, ["number", "number"]);
+    superposition_set_entropy_queue = cwrap("superposition_set_entropy_queue", null, ["number", "number"]);
     superposition_free = cwrap("superposition_free", null, ["number"]);
+    world_generate_chunks = cwrap("world_generate_chunks", "number", ["number", "number", "number", "number", "number", "number", "number"]);
+}
+
+export enum CollapseResult {
+    Failed = -1,
+    Unfinished = 0,
+    Finished = 1
+}
+
+export enum RepairMode {
+    Backtrack = 0,
+    RegionRestart = 1
+}
+
+export enum PropagationEngine {
+    Table = 0,
+    Support = 1
+}
+
+export enum EntropyQueue {
+    Heap = 0,
+    Buckets = 1
+}
+
+export enum InitPhase {
+    NaiveFields = 0,
+    Borders = 1,
+    Propagate = 2,
+    Supports = 3,
+    Entropies = 4,
+    Done = 5
 }
 
 class SuperpositionAbstract {
@@ -31,13 +87,17 @@ class SuperpositionAbstract {
     printEntropies() {
         const entropiesPtr = getValue(this.ptr + 20, "*");
         const tileEntropies = getValue(entropiesPtr + 0, "i32*");
-        const width = getValue(entropiesPtr + 16, "i32");
-        const height = getValue(entropiesPtr + 20, "i32");
+        const width = getValue(entropiesPtr + 12, "i32");
+        const height = getValue(entropiesPtr + 16, "i32");
+
+        // tiles are stored in 8x8 blocks, see get_tile_index in superposition.c
+        const blocksWidth = (width + 7) >> 3;
 
         for (let y = 0; y < height; y++) {
             const line = [];
             for (let x = 0; x < width; x++) {
-                line.push(String(getValue(tileEntropies + (x + y * width) * 4, "i32")).padEnd(6, " "));
+                const tileIndex = ((x >> 3) + (y >> 3) * blocksWidth) << 6 | (y & 7) << 3 | (x & 7);
+                line.push(String(getValue(tileEntropies + tileIndex * 4, "i32")).padEnd(6, " "));
             }
             console.log(`${y}| ` + line.join(""));
         }
@@ -47,8 +107,72 @@ class SuperpositionAbstract {
         superposition_select_collapse_area(this.ptr, u, v, width, height);
     }
 
-    collapse(amount: number) {
-        superposition_collapse_tiles(this.ptr, amount);
+    // like selectCollapseArea but the area is initalized by collapseFor, so it can be spread over frames
+    beginCollapseArea(u: number, v: number, width: number, height: number) {
+        superposition_begin_collapse_area(this.ptr, u, v, width, height);
+    }
+
+    collapse(amount: number): CollapseResult {
+        return superposition_collapse_tiles(this.ptr, amount);
+    }
+
+    // do as much work as fits in the budget, call again next frame while it's unfinished
+    collapseFor(budgetMs: number): CollapseResult {
+        return superposition_collapse_for(this.ptr, Math.round(budgetMs * 1000));
+    }
+
+    get initPhase(): InitPhase {
+        return superposition_get_init_phase(this.ptr);
+    }
+
+    // tiles left to collapse
+    get remaining(): number {
+        return superposition_get_remaining(this.ptr);
+    }
+
+    // backtracks allowed per collapse area before it fails, zero disables backtracking
+    setBacktrackLimit(limit: number) {
+        superposition_set_backtrack_limit(this.ptr, limit);
+    }
+
+    // takes effect from the next collapse area
+    setRepairMode(mode: RepairMode) {
+        superposition_set_repair_mode(this.ptr, mode);
+    }
+
+    setPropagationEngine(engine: PropagationEngine) {
+        superposition_set_propagation_engine(this.ptr, engine);
+    }
+
+    setEntropyQueue(queue: EntropyQueue) {
+        superposition_set_entropy_queue(this.ptr, queue);
+    }
+
+    // create and fully generate chunks in one call, returns how many were generated without failing
+    protected generate(chunks: { x: number, y: number }[], sourceWorldPtr: number, tileDistributionsPtr: number, distributionSize: number): number {
+        const coordsPtr = mallocInst(chunks.length * 8);
+
+        for (let i = 0; i < chunks.length; i++) {
+            heap32[(coordsPtr >> 2) + i * 2] = chunks[i].x;
+            heap32[(coordsPtr >> 2) + i * 2 + 1] = chunks[i].y;
+        }
+
+        const generated = world_generate_chunks(this.destinationWorld.ptr, coordsPtr, chunks.length, this.ptr, sourceWorldPtr, tileDistributionsPtr, distributionSize);
+        freeInst(coordsPtr);
+
+        return generated;
+    }
+
+    get repairs(): number {
+        return superposition_get_repairs(this.ptr);
+    }
+
+    get backtracks(): number {
+        return superposition_get_backtracks(this.ptr);
+    }
+
+    get decisionDepth(): number {
+        return superposition_get_decision_depth(this.ptr);
     }
 
     free() {
@@ -74,6 +198,10 @@ export class SimpleSuperposition extends SuperpositionAbstract {
         super(ptr, destinationWorld);
         this.area = area;
     }
+
+    generateChunks(chunks: { x: number, y: number }[]): number {
+        return this.generate(chunks, 0, 0, 0);
+    }
 }
 
 export class FractalSuperposition extends SuperpositionAbstract {
@@ -92,6 +220,21 @@ export class FractalSuperposition extends SuperpositionAbstract {
         this.sourceWorld = sourceWorld;
     }
 
+    // distributions areas for each chunk are built from the source world in wasm
+    generateChunks(chunks: { x: number, y: number }[]): number {
+        const distributions = this.sourceWorld.tileset.distributions;
+        const tileDistributionsPtr = mallocInst(distributions.length * 4);
+
+        for (let i = 0; i < distributions.length; i++) {
+            setValue(tileDistributionsPtr + i * 4, distributions[i].ptr, "*");
+        }
+
+        const generated = this.generate(chunks, this.sourceWorld.ptr, tileDistributionsPtr, this.sourceWorld.distributionSize);
+        freeInst(tileDistributionsPtr);
+
+        return generated;
+    }
+
     selectChunk(x: number, y: number) {
         const chunkSize = this.destinationWorld.chunkSize;
         const area = this.sourceWorld.getArea(x * chunkSize, y * chunkSize, chunkSize);
@@ -1,117 +1,259 @@
 #include "tileset.h"
 
 void tileset_free(Tileset* tileset) {
-	free_inst(tileset->render_data_table);
-	free_inst(tileset->tile_table);
-	free_inst(tileset->edge_table);
+	if (tileset->file_data == NULL) {
+		free_inst(tileset->render_data_table);
+		free_inst(tileset->tile_table);
+		free_inst(tileset->edge_table);
+		free_inst(tileset->tile_edges);
+	} else if (tileset->file_is_mapped) {
+#ifndef __EMSCRIPTEN__
+		munmap(tileset->file_data, tileset->file_size);
+#endif
+	} else {
+		free_inst(tileset->file_data);
+	}
+
 	free_inst(tileset);
 }
 
-void tileset_find_tile_edge(Tileset* tileset, BitField tile_field, BitField edge_field, int direction) {
-	field_clear(edge_field, tileset->edge_field_size);
+int tileset_get_tile_count(Tileset* tileset) {
+	return tileset->tile_count;
+}
+
+// entries for the non zero values of each chunk of a field, there's no entry for zero since it never adds anything
+#define table_chunk_entries(chunk_bits) ((1 << (chunk_bits)) - 1)
+#define table_entry_index(chunk_bits, chunk, value) ((chunk) * table_chunk_entries(chunk_bits) + (value) - 1)
 
-	// look up each byte in the tile_field, combine to find the edge_field for the tile
-	for (int i = 0; i < tileset->tile_field_size * 16; i++) {
-		const uint8_t byte = field_get_byte(tile_field, i);
-		if (byte == 0) continue;  // no tiles set
-		BitField edge_table_byte = tileset->edge_table + i * tileset->edge_table_byte_size;
-		BitField byte_edge_field = edge_table_byte + ((byte * 4 + direction) * tileset->edge_field_size);
-		field_or(edge_field, byte_edge_field, tileset->edge_field_size);
+// OR in the table entry of each non zero chunk of field, entries are entry_size frames
+void table_or_entries(BitField table, int chunk_bits, BitField field, int field_size, BitField result, int entry_size) {
+	uint32_t chunk_mask = table_chunk_entries(chunk_bits);
+	int chunks_per_byte = 8 / chunk_bits;
+
+	for (int i = 0; i < field_size; i++) {
+		uint32_t byte = field_get_byte(field, i);
+
+		// only visit chunks with bits set
+		while (byte != 0) {
+			int chunk = __builtin_ctz(byte) / chunk_bits;
+			uint32_t value = (byte >> (chunk * chunk_bits)) & chunk_mask;
+			byte &= ~(chunk_mask << (chunk * chunk_bits));
+
+			BitField entry = table + table_entry_index(chunk_bits, i * chunks_per_byte + chunk, value) * entry_size;
+			field_or(result, entry, entry_size * BIT_FIELD_FRAME_SIZE);
+		}
 	}
 }
 
-void tileset_constrain_tile(Tileset* tileset, BitField tile_field, BitField edge_field, int direction) {
-	BitField table = tileset->tile_table;
-	table += tileset->tile_table_direction_size * direction;
+// set bit in the entry of every value of the chunk holding index, the field it's set in starts offset frames into the entry
+void table_add_bit(BitField table, int chunk_bits, int index, int entry_size, int offset, int bit) {
+	int chunk = index / chunk_bits;
+	int chunk_bit = 1 << (index % chunk_bits);
 
-	BitFieldFrame constraint[bit_field_storage_frame_size(tileset->tile_field_size)];
+	for (int value = 1; value <= table_chunk_entries(chunk_bits); value++) {
+		if (!(value & chunk_bit)) continue;
+		field_set_bit(table + table_entry_index(chunk_bits, chunk, value) * entry_size + offset, bit);
+	}
+}
 
-	// look up each byte in the edge_field, combine to find the constraint on tile_field
-	for (int i = 0; i < tileset->edge_field_size * 16; i++) {
-		const uint8_t byte = field_get_byte(edge_field, i);
-		if (byte == 0) continue;  // no edges set
-		BitField byte_tile_field = table + (i * 256 + byte) * tileset->tile_field_size;
-		field_or(constraint, byte_tile_field, tileset->tile_field_size);
+void tileset_find_tile_edges(Tileset* tileset, BitField tile_field, BitField edge_fields) {
+	int edge_frames = bit_field_storage_frame_size(tileset->edge_field_size);
+
+	// edge_fields is the four directions one after the other, the same as an edge table entry
+	for (int direction = 0; direction < 4; direction++) {
+		field_clear(field_index_array(edge_fields, tileset->edge_field_size, direction), tileset->edge_field_size);
 	}
 
-	field_and(tile_field, constraint, tileset->tile_field_size);
+	table_or_entries(tileset->edge_table, tileset->table_chunk_bits, tile_field, tileset->tile_field_size, edge_fields, edge_frames * 4);
 }
 
-void tileset_add_edge_table_entry(Tileset* tileset, int tile, int right_edge, int top_edge, int left_edge, int bottom_edge) {
-	int tile_byte_index = tile / 8;
-	int tile_bit_index = tile % 8;
-
-	BitField table = tileset->edge_table;
-	table += tileset->edge_table_byte_size * tile_byte_index;
-
-	// iterate though all byte values with tile_bit_index set
-	for (int i = 0; i < 256; i += (2 << tile_bit_index)) {
-		for (int j = 0; j < (1 << tile_bit_index); j++) {
-			int byte = (1 << tile_bit_index) + i + j;
-			BitField byte_edge_table = table + byte * 4 * tileset->edge_field_size;
-			field_set_bit(byte_edge_table + tileset->edge_field_size * 0, right_edge);
-			field_set_bit(byte_edge_table + tileset->edge_field_size * 1, top_edge);
-			field_set_bit(byte_edge_table + tileset->edge_field_size * 2, left_edge);
-			field_set_bit(byte_edge_table + tileset->edge_field_size * 3, bottom_edge);
+// constrain tile_field by the tile table entries of edge_field's chunks, returns FIELD_CHANGED and FIELD_EMPTY flags
+// the constraint is ORed up in locals, then ANDed in while the removed tiles and what's left are ORed together, so
+// both flags come from a single any_true each instead of counting the field before and after
+// frames is a constant for the common sizes, the loops over it are unrolled and the constraint stays in registers
+// bigger fields go CONSTRAIN_BLOCK_FRAMES at a time, walking the edge field again for each block
+static inline __attribute__((always_inline)) int constrain_tile_frames(BitField table, int chunk_bits, BitField edge_field, int edge_field_size, BitField tile_field, BitField removed, int frames) {
+	uint32_t chunk_mask = table_chunk_entries(chunk_bits);
+	int chunks_per_byte = 8 / chunk_bits;
+	v128_t any_removed = wasm_i32x4_splat(0), any_left = wasm_i32x4_splat(0);
+
+	for (int block = 0; block < frames; block += CONSTRAIN_BLOCK_FRAMES) {
+		int block_frames = frames - block < CONSTRAIN_BLOCK_FRAMES ? frames - block : CONSTRAIN_BLOCK_FRAMES;
+
+		v128_t constraint[CONSTRAIN_BLOCK_FRAMES];
+		for (int f = 0; f < block_frames; f++) constraint[f] = wasm_i32x4_splat(0);
+
+		for (int i = 0; i < edge_field_size; i++) {
+			uint32_t byte = field_get_byte(edge_field, i);
+
+			while (byte != 0) {
+				int chunk = __builtin_ctz(byte) / chunk_bits;
+				uint32_t value = (byte >> (chunk * chunk_bits)) & chunk_mask;
+				byte &= ~(chunk_mask << (chunk * chunk_bits));
+
+				BitField entry = table + table_entry_index(chunk_bits, i * chunks_per_byte + chunk, value) * frames + block;
+				for (int f = 0; f < block_frames; f++) constraint[f] = wasm_v128_or(constraint[f], wasm_v128_load(entry + f));
+			}
+		}
+
+		for (int f = 0; f < block_frames; f++) {
+			v128_t tiles = wasm_v128_load(tile_field + block + f);
+			v128_t left = wasm_v128_and(tiles, constraint[f]);
+			v128_t removed_tiles = wasm_v128_andnot(tiles, constraint[f]);
+
+			wasm_v128_store(tile_field + block + f, left);
+			if (removed != NULL) wasm_v128_store(removed + block + f, removed_tiles);
+
+			any_removed = wasm_v128_or(any_removed, removed_tiles);
+			any_left = wasm_v128_or(any_left, left);
 		}
 	}
+
+	return (wasm_v128_any_true(any_removed) ? FIELD_CHANGED : 0) | (wasm_v128_any_true(any_left) ? 0 : FIELD_EMPTY);
 }
 
-void tileset_add_tile_table_direction_entry(Tileset* tileset, int direction, int tile, int edge) {
-	int edge_byte_index = edge / 8;
-	int edge_bit_index = edge % 8;
+int constrain_tile_generic(BitField table, int chunk_bits, BitField edge_field, int edge_field_size, BitField tile_field, int tile_field_size, BitField removed) {
+	return constrain_tile_frames(table, chunk_bits, edge_field, edge_field_size, tile_field, removed, bit_field_storage_frame_size(tile_field_size));
+}
 
-	BitField table = tileset->tile_table;
-	table += tileset->tile_table_direction_size * direction;
-	table += edge_byte_index * 256 * tileset->tile_field_size;
+#define define_tileset_kernels(frames)                                                                                                                                  \
+	int constrain_tile_##frames(BitField table, int chunk_bits, BitField edge_field, int edge_field_size, BitField tile_field, int tile_field_size, BitField removed) { \
+		return constrain_tile_frames(table, chunk_bits, edge_field, edge_field_size, tile_field, removed, frames);                                                      \
+	}                                                                                                                                                                   \
+	const TilesetKernels tileset_kernels_##frames = {constrain_tile_##frames, &field_kernels_##frames};
 
-	// iterate though all byte values with edge_bit_index set
-	for (int i = 0; i < 256; i += (2 << edge_bit_index)) {
-		for (int j = 0; j < (1 << edge_bit_index); j++) {
-			int byte = (1 << edge_bit_index) + i + j;
-			BitField tile_field = table + byte * tileset->tile_field_size;
-			field_set_bit(tile_field, tile);
-		}
+// 128, 256 and 512 tiles, the sizes most tilesets are made for
+define_tileset_kernels(1)
+define_tileset_kernels(2)
+define_tileset_kernels(4)
+
+const TilesetKernels tileset_kernels_generic = {constrain_tile_generic, &field_kernels_generic};
+
+// other sizes fall back to the loops over frames
+const TilesetKernels* tileset_get_kernels(int tile_field_size) {
+	switch (bit_field_storage_frame_size(tile_field_size)) {
+		case 1: return &tileset_kernels_1;
+		case 2: return &tileset_kernels_2;
+		case 4: return &tileset_kernels_4;
+		default: return &tileset_kernels_generic;
+	}
+}
+
+// returns FIELD_CHANGED if any tiles were removed and FIELD_EMPTY if none are left
+int tileset_constrain_tile(Tileset* tileset, BitField tile_field, BitField edge_field, int direction) {
+	BitField table = tileset->tile_table + tileset->tile_table_direction_size * direction;
+	return tileset->kernels->constrain_tile(table, tileset->table_chunk_bits, edge_field, tileset->edge_field_size, tile_field, tileset->tile_field_size, NULL);
+}
+
+// the same as tileset_constrain_tile, and the tiles it removes are written to removed
+int tileset_constrain_tile_removed(Tileset* tileset, BitField tile_field, BitField edge_field, int direction, BitField removed) {
+	BitField table = tileset->tile_table + tileset->tile_table_direction_size * direction;
+	return tileset->kernels->constrain_tile(table, tileset->table_chunk_bits, edge_field, tileset->edge_field_size, tile_field, tileset->tile_field_size, removed);
+}
+
+// tiles that have an edge in a direction, this is the tile table entry for a chunk with just that edge set
+BitField tileset_get_edge_tiles(Tileset* tileset, int direction, int edge) {
+	int chunk_bits = tileset->table_chunk_bits;
+	BitField table = tileset->tile_table + tileset->tile_table_direction_size * direction;
+
+	return table + table_entry_index(chunk_bits, edge / chunk_bits, 1 << (edge % chunk_bits)) * bit_field_storage_frame_size(tileset->tile_field_size);
+}
+
+int tileset_get_tile_edge(Tileset* tileset, int tile, int direction) {
+	return tileset->tile_edges[tile * 4 + direction];
+}
+
+void tileset_add_edge_table_entry(Tileset* tileset, int tile, int right_edge, int top_edge, int left_edge, int bottom_edge) {
+	int edge_frames = bit_field_storage_frame_size(tileset->edge_field_size);
+	int edges[4] = {right_edge, top_edge, left_edge, bottom_edge};
+
+	// an entry holds the edge fields for all four directions
+	for (int direction = 0; direction < 4; direction++) {
+		table_add_bit(tileset->edge_table, tileset->table_chunk_bits, tile, edge_frames * 4, edge_frames * direction, edges[direction]);
 	}
 }
 
 void tileset_add_tile_table_entry(Tileset* tileset, int tile, int right_edge, int top_edge, int left_edge, int bottom_edge) {
-	tileset_add_tile_table_direction_entry(tileset, 0, tile, right_edge);
-	tileset_add_tile_table_direction_entry(tileset, 1, tile, top_edge);
-	tileset_add_tile_table_direction_entry(tileset, 2, tile, left_edge);
-	tileset_add_tile_table_direction_entry(tileset, 3, tile, bottom_edge);
+	int edges[4] = {right_edge, top_edge, left_edge, bottom_edge};
+
+	for (int direction = 0; direction < 4; direction++) {
+		BitField table = tileset->tile_table + tileset->tile_table_direction_size * direction;
+		table_add_bit(table, tileset->table_chunk_bits, edges[direction], bit_field_storage_frame_size(tileset->tile_field_size), 0, tile);
+	}
 }
 
 void tileset_add_tile(Tileset* tileset, int tile, uint32_t render_data, int right_edge, int top_edge, int left_edge, int bottom_edge) {
 	tileset->render_data_table[tile] = render_data;
+
+	tileset->tile_edges[tile * 4 + 0] = right_edge;
+	tileset->tile_edges[tile * 4 + 1] = top_edge;
+	tileset->tile_edges[tile * 4 + 2] = left_edge;
+	tileset->tile_edges[tile * 4 + 3] = bottom_edge;
+	if (tile >= tileset->tile_count) tileset->tile_count = tile + 1;
+
 	tileset_add_tile_table_entry(tileset, tile, right_edge, top_edge, left_edge, bottom_edge);
 	tileset_add_edge_table_entry(tileset, tile, right_edge, top_edge, left_edge, bottom_edge);
 }
 
-Tileset* tileset_create(int edge_field_size, int tile_field_size) {
-	int tile_table_direction_size = edge_field_size * 256 * tile_field_size;
-	int edge_table_byte_size = 256 * 4 * edge_field_size;
+// sizes in frames, entries are a tile field for each chunk value of an edge field or four edge fields for each chunk value of a tile field
+int get_tile_table_direction_size(int edge_field_size, int tile_field_size, int table_chunk_bits) {
+	return edge_field_size * 8 / table_chunk_bits * table_chunk_entries(table_chunk_bits) * bit_field_storage_frame_size(tile_field_size);
+}
+
+int get_edge_table_size(int edge_field_size, int tile_field_size, int table_chunk_bits) {
+	return tile_field_size * 8 / table_chunk_bits * table_chunk_entries(table_chunk_bits) * 4 * bit_field_storage_frame_size(edge_field_size);
+}
 
+// bytes taken by the tile and edge tables
+int tileset_get_table_size(int edge_field_size, int tile_field_size, int table_chunk_bits) {
+	int frames = 4 * get_tile_table_direction_size(edge_field_size, tile_field_size, table_chunk_bits) + get_edge_table_size(edge_field_size, tile_field_size, table_chunk_bits);
+	return frames * sizeof(BitFieldFrame);
+}
+
+Tileset* tileset_create_with_chunk_bits(int edge_field_size, int tile_field_size, int table_chunk_bits) {
 	Tileset* tileset = malloc_inst(sizeof(Tileset));
 
 	if (tileset == NULL) {
-		fprintf(stderr, "Failed to allocate memory: tileset_create()\n");
+		fprintf(stderr, "Failed to allocate memory: tileset_create_with_chunk_bits()\n");
 		exit(1);
 	}
 
+	int tile_table_direction_size = get_tile_table_direction_size(edge_field_size, tile_field_size, table_chunk_bits);
+	int edge_table_size = get_edge_table_size(edge_field_size, tile_field_size, table_chunk_bits);
+
 	tileset->tile_table = calloc_inst(4 * tile_table_direction_size, sizeof(BitFieldFrame));
-	tileset->edge_table = calloc_inst(tile_field_size * edge_table_byte_size, sizeof(BitFieldFrame));
+	tileset->edge_table = calloc_inst(edge_table_size, sizeof(BitFieldFrame));
 	tileset->render_data_table = malloc_inst(tile_field_size * 8 * sizeof(uint32_t));
+	tileset->tile_edges = calloc_inst(tile_field_size * 8 * 4, sizeof(uint16_t));
 
-	if (tileset->tile_table == NULL || tileset->edge_table == NULL || tileset->render_data_table == NULL) {
-		fprintf(stderr, "Failed to allocate memory: tileset_create()\n");
+	if (tileset->tile_table == NULL || tileset->edge_table == NULL || tileset->render_data_table == NULL || tileset->tile_edges == NULL) {
+		fprintf(stderr, "Failed to allocate memory: tileset_create_with_chunk_bits()\n");
 		exit(1);
 	}
 
 	tileset->edge_field_size = edge_field_size;
 	tileset->tile_field_size = tile_field_size;
+	tileset->table_chunk_bits = table_chunk_bits;
 	tileset->tile_table_direction_size = tile_table_direction_size;
-	tileset->edge_table_byte_size = edge_table_byte_size;
+	tileset->tile_count = 0;
+	tileset->kernels = tileset_get_kernels(tile_field_size);
+
+	tileset->file_data = NULL;
+	tileset->file_size = 0;
+	tileset->file_is_mapped = 0;
 
 	return tileset;
 }
+
+// byte chunks take one lookup for every 8 bits but their tables are 8 times the size of 4 bit ones and 32 times 1 bit ones
+// while the tables stay in cache bytes are up to twice as fast on dense fields and about even on sparse ones, so the
+// biggest chunks whose tables fit in TILESET_TABLE_BUDGET are used, see bench/tileset.c
+Tileset* tileset_create(int edge_field_size, int tile_field_size) {
+	int table_chunk_bits = 8;
+
+	while (table_chunk_bits > 1 && tileset_get_table_size(edge_field_size, tile_field_size, table_chunk_bits) > TILESET_TABLE_BUDGET) {
+		table_chunk_bits /= 2;
+	}
+
+	return tileset_create_with_chunk_bits(edge_field_size, tile_field_size, table_chunk_bits);
+}
@@ -1,27 +1,61 @@
 #ifndef TILESET_GUARD
 #define TILESET_GUARD
 
-#include <emscripten.h>
 #include <stdint.h>
 #include <stdio.h>
 
+#ifndef __EMSCRIPTEN__
+#include <sys/mman.h>
+#endif
+
 #include "bitfield.h"
 #include "meminst.h"
+#include "platform.h"
+
+// the tables map each chunk of a field to the fields it ORs in, chunks are 8, 4 or 1 bits
+// smaller chunks mean more lookups for a field but much smaller tables, see tileset_create
+#define TILESET_TABLE_BUDGET 262144  // bytes the tables can take up before smaller chunks are used
+#define CONSTRAIN_BLOCK_FRAMES 4  // frames of a tile field constrained at once, the most the unrolled kernels take
+
+// constrains tile_field by the tile table entries of edge_field's chunks, removed can be NULL
+typedef int (*ConstrainKernel)(BitField table, int chunk_bits, BitField edge_field, int edge_field_size, BitField tile_field, int tile_field_size, BitField removed);
+
+// kernels for a tile field size, picked when the tileset is created, see tileset_get_kernels
+typedef struct {
+	ConstrainKernel constrain_tile;
+	const FieldKernels* tile_fields;
+} TilesetKernels;
 
 typedef struct {
 	int edge_field_size;
 	int tile_field_size;
-	int tile_table_direction_size;
-	int edge_table_byte_size;
-	BitField tile_table;
-	BitField edge_table;
+	int table_chunk_bits;
+	int tile_table_direction_size;	// in frames
+	BitField tile_table;			// tile field for each chunk value of an edge field, by direction
+	BitField edge_table;			// edge fields of all four directions for each chunk value of a tile field
 	uint32_t* render_data_table;
+	uint16_t* tile_edges;  // edge of each tile in each direction
+	int tile_count;		   // one past the highest tile added
+
+	// tilesets loaded by tileset_file_load or tileset_file_map keep their tables in the file
+	void* file_data;
+	size_t file_size;
+	int file_is_mapped;
+
+	const TilesetKernels* kernels;
 } Tileset;
 
 extern EMSCRIPTEN_KEEPALIVE Tileset* tileset_create(int edge_field_size, int tile_field_size);
-void tileset_constrain_tile(Tileset* tileset, BitField tile_field, BitField edge_field, int direction);
-void tileset_find_tile_edge(Tileset* tileset, BitField tile_field, BitField edge_field, int direction);
+Tileset* tileset_create_with_chunk_bits(int edge_field_size, int tile_field_size, int table_chunk_bits);
+int tileset_get_table_size(int edge_field_size, int tile_field_size, int table_chunk_bits);
+int tileset_constrain_tile(Tileset* tileset, BitField tile_field, BitField edge_field, int direction);
+int tileset_constrain_tile_removed(Tileset* tileset, BitField tile_field, BitField edge_field, int direction, BitField removed);
+void tileset_find_tile_edges(Tileset* tileset, BitField tile_field, BitField edge_fields);
+BitField tileset_get_edge_tiles(Tileset* tileset, int direction, int edge);
+int tileset_get_tile_edge(Tileset* tileset, int tile, int direction);
 extern EMSCRIPTEN_KEEPALIVE void tileset_add_tile(Tileset* tileset, int tile, uint32_t render_data, int right_edge, int top_edge, int left_edge, int bottom_edge);
+const TilesetKernels* tileset_get_kernels(int tile_field_size);
+extern EMSCRIPTEN_KEEPALIVE int tileset_get_tile_count(Tileset* tileset);
 extern EMSCRIPTEN_KEEPALIVE void tileset_free(Tileset* tileset);
 
 #endif
\ No newline at end of file
@@ -2,6 +2,7 @@ import { Distribution } from "./distribution";
 
 let tileset_create: (edge_field_size: number, tile_field_size: number) => number;
 let tileset_add_tile: (tileset: number, tile: number, render_data: number, right_edge: number, top_edge: number, left_edge: number, bottom_edge: number) => void;
+let tileset_get_tile_count: (tileset: number) => number;
 let tileset_free: (ptr: number) => null;
 
 const tilesetRegistry = new FinalizationRegistry((ptr: number) => {
@@ -11,6 +12,7 @@ const tilesetRegistry = new FinalizationRegistry((ptr: number) => {
 export function init() {
     tileset_create = cwrap("tileset_create", "number", ["number", "number"]);
     tileset_add_tile = cwrap("tileset_add_tile", null, ["number", "number", "number", "number", "number", "number", "number"]);
+    tileset_get_tile_count = cwrap("tileset_get_tile_count", "number", ["number"]);
     tileset_free = cwrap("tileset_free", null, ["number"]);
 }
 
@@ -19,7 +21,7 @@ export class Tileset {
     readonly edgeLimit: number;
     readonly tileLimit: number;
 
-    tileCount = 0;
+    tileCount: number;
 
     static create(edgeLimit: number = 128, tileLimit: number = 128): Tileset {
         const tileset = new Tileset(tileset_create((edgeLimit + 7) >> 3, (tileLimit + 7) >> 3));
@@ -27,10 +29,18 @@ export class Tileset {
         return tileset;
     }
 
+    // takes ownership of a tileset made in c, like one loaded from a file
+    static fromPtr(ptr: number): Tileset {
+        const tileset = new Tileset(ptr);
+        tilesetRegistry.register(tileset, tileset.ptr, tileset);
+        return tileset;
+    }
+
     constructor(ptr: number) {
         this.ptr = ptr;
         this.edgeLimit = getValue(this.ptr + 0, "i32") * 8;
         this.tileLimit = getValue(this.ptr + 4, "i32") * 8;
+        this.tileCount = tileset_get_tile_count(this.ptr);
     }
 
     addTile(textureId: number, transformation: number, edge: number): number;
@@ -0,0 +1,256 @@
+#include "tilesetfile.h"
+
+void tileset_file_free(TilesetFile* file) {
+	free_inst(file->distributions);
+	free_inst(file);
+}
+
+int get_distribution_record_size(int tile_field_size) {
+	int weights_size = tileset_file_align(tile_field_size * 8 * sizeof(Entropy));
+	return tileset_file_align(sizeof(TilesetFileDistribution)) + weights_size * 2 + bit_field_storage_frame_size(tile_field_size) * sizeof(BitFieldFrame);
+}
+
+// bake a tileset and its distributions into one buffer, its size is in the header, see tileset_file_get_size
+void* tileset_file_create(Tileset* tileset, Distribution** distributions, int distribution_count) {
+	TilesetFileHeader header;
+	memset(&header, 0, sizeof(header));
+
+	header.magic = TILESET_FILE_MAGIC;
+	header.version = TILESET_FILE_VERSION;
+	header.edge_field_size = tileset->edge_field_size;
+	header.tile_field_size = tileset->tile_field_size;
+	header.table_chunk_bits = tileset->table_chunk_bits;
+	header.tile_count = tileset->tile_count;
+	header.distribution_count = distribution_count;
+
+	header.tile_table_size = 4 * tileset->tile_table_direction_size * sizeof(BitFieldFrame);
+	header.edge_table_size = tileset_get_table_size(tileset->edge_field_size, tileset->tile_field_size, tileset->table_chunk_bits) - header.tile_table_size;
+
+	header.tile_table_offset = tileset_file_align(sizeof(TilesetFileHeader));
+	header.edge_table_offset = header.tile_table_offset + tileset_file_align(header.tile_table_size);
+	header.render_data_offset = header.edge_table_offset + tileset_file_align(header.edge_table_size);
+	header.tile_edges_offset = header.render_data_offset + tileset_file_align(tileset->tile_field_size * 8 * sizeof(uint32_t));
+	header.distributions_offset = header.tile_edges_offset + tileset_file_align(tileset->tile_field_size * 8 * 4 * sizeof(uint16_t));
+
+	header.size = header.distributions_offset;
+	for (int i = 0; i < distribution_count; i++) {
+		header.size += get_distribution_record_size(distributions[i]->tile_field_size);
+	}
+
+	uint8_t* data = calloc_inst(1, header.size);
+
+	if (data == NULL) {
+		fprintf(stderr, "Failed to allocate memory: tileset_file_create()\n");
+		exit(1);
+	}
+
+	memcpy(data, &header, sizeof(header));
+	memcpy(data + header.tile_table_offset, tileset->tile_table, header.tile_table_size);
+	memcpy(data + header.edge_table_offset, tileset->edge_table, header.edge_table_size);
+	memcpy(data + header.render_data_offset, tileset->render_data_table, tileset->tile_field_size * 8 * sizeof(uint32_t));
+	memcpy(data + header.tile_edges_offset, tileset->tile_edges, tileset->tile_field_size * 8 * 4 * sizeof(uint16_t));
+
+	uint8_t* record = data + header.distributions_offset;
+
+	for (int i = 0; i < distribution_count; i++) {
+		Distribution* distribution = distributions[i];
+		int weights_size = distribution->tile_field_size * 8 * sizeof(Entropy);
+
+		TilesetFileDistribution record_header;
+		memset(&record_header, 0, sizeof(record_header));
+		record_header.tile_field_size = distribution->tile_field_size;
+		record_header.size = get_distribution_record_size(distribution->tile_field_size);
+		memcpy(record, &record_header, sizeof(record_header));
+
+		uint8_t* weights = record + tileset_file_align(sizeof(TilesetFileDistribution));
+		uint8_t* weight_log_weights = weights + tileset_file_align(weights_size);
+		uint8_t* all_tiles = weight_log_weights + tileset_file_align(weights_size);
+
+		memcpy(weights, distribution->weights, weights_size);
+		memcpy(weight_log_weights, distribution->weight_log_weights, weights_size);
+		memcpy(all_tiles, distribution->all_tiles, bit_field_storage_frame_size(distribution->tile_field_size) * sizeof(BitFieldFrame));
+
+		record += record_header.size;
+	}
+
+	return data;
+}
+
+int tileset_file_get_size(void* data) {
+	TilesetFileHeader* header = data;
+	return header->size;
+}
+
+// whether a section of length bytes at offset fits in a file of size bytes, without overflowing
+int section_fits(uint64_t offset, uint64_t length, uint64_t size) {
+	return offset <= size && length <= size - offset;
+}
+
+// returns 0 and says why if the file can't be used
+int check_tileset_file(TilesetFileHeader* header, size_t size) {
+	if (size < sizeof(TilesetFileHeader) || header->magic != TILESET_FILE_MAGIC) {
+		fprintf(stderr, "Not a tileset file: check_tileset_file()\n");
+		return 0;
+	}
+
+	if (header->version != TILESET_FILE_VERSION) {
+		fprintf(stderr, "Tileset file is version %u, expected %u: check_tileset_file()\n", header->version, TILESET_FILE_VERSION);
+		return 0;
+	}
+
+	int chunk_bits = header->table_chunk_bits;
+	int sizes_valid = header->edge_field_size > 0 && header->edge_field_size <= TILESET_FILE_FIELD_SIZE_LIMIT && header->tile_field_size > 0 && header->tile_field_size <= TILESET_FILE_FIELD_SIZE_LIMIT;
+	int chunk_bits_valid = chunk_bits == 1 || chunk_bits == 2 || chunk_bits == 4 || chunk_bits == 8;
+	int64_t table_size = sizes_valid && chunk_bits_valid ? tileset_get_table_size(header->edge_field_size, header->tile_field_size, chunk_bits) : -1;
+
+	uint64_t file_size = header->size;
+	uint64_t tile_count = header->tile_field_size * 8;
+
+	int valid = file_size <= size && table_size == (int64_t)header->tile_table_size + header->edge_table_size && header->tile_table_size % (4 * sizeof(BitFieldFrame)) == 0;
+	valid = valid && header->tile_count >= 0 && header->tile_count <= tile_count && header->distribution_count >= 0;
+	valid = valid && section_fits(header->tile_table_offset, header->tile_table_size, file_size);
+	valid = valid && section_fits(header->edge_table_offset, header->edge_table_size, file_size);
+	valid = valid && section_fits(header->render_data_offset, tile_count * sizeof(uint32_t), file_size);
+	valid = valid && section_fits(header->tile_edges_offset, tile_count * 4 * sizeof(uint16_t), file_size);
+	valid = valid && section_fits(header->distributions_offset, 0, file_size);
+
+	// tables are used where they are, so they have to be on frame boundaries
+	uint32_t offsets = header->tile_table_offset | header->edge_table_offset | header->render_data_offset | header->tile_edges_offset | header->distributions_offset;
+	valid = valid && offsets % TILESET_FILE_ALIGNMENT == 0;
+
+	// edges index the support counts, so every tile's edges have to be inside the edge fields
+	uint16_t* tile_edges = (uint16_t*)((uint8_t*)header + header->tile_edges_offset);
+	for (int i = 0; valid && i < header->tile_count * 4; i++) {
+		valid = tile_edges[i] < header->edge_field_size * 8;
+	}
+
+	// every distribution record has to be whole and for this tileset's tiles
+	uint64_t record_offset = header->distributions_offset;
+	uint64_t record_size = get_distribution_record_size(header->tile_field_size);
+
+	for (int i = 0; valid && i < header->distribution_count; i++) {
+		TilesetFileDistribution* record_header = (TilesetFileDistribution*)((uint8_t*)header + record_offset);
+
+		valid = section_fits(record_offset, sizeof(TilesetFileDistribution), file_size);
+		valid = valid && record_header->tile_field_size == header->tile_field_size && record_header->size == record_size;
+		valid = valid && section_fits(record_offset, record_size, file_size);
+
+		// weight sums index the log weight table, so weights can't be negative
+		Entropy* weights = (Entropy*)((uint8_t*)record_header + tileset_file_align(sizeof(TilesetFileDistribution)));
+		for (uint64_t tile = 0; valid && tile < tile_count; tile++) {
+			valid = weights[tile] >= 0;
+		}
+
+		record_offset += record_size;
+	}
+
+	if (!valid) {
+		fprintf(stderr, "Tileset file is truncated or corrupt: check_tileset_file()\n");
+		return 0;
+	}
+
+	return 1;
+}
+
+// point a tileset at the tables in data and load the distributions after them, data then belongs to the tileset
+TilesetFile* read_tileset_file(uint8_t* data, size_t size, int is_mapped) {
+	TilesetFileHeader* header = (TilesetFileHeader*)data;
+	if (!check_tileset_file(header, size)) return NULL;
+
+	TilesetFile* file = malloc_inst(sizeof(TilesetFile));
+	Tileset* tileset = malloc_inst(sizeof(Tileset));
+	Distribution** distributions = malloc_inst((header->distribution_count > 0 ? header->distribution_count : 1) * sizeof(Distribution*));
+
+	if (file == NULL || tileset == NULL || distributions == NULL) {
+		fprintf(stderr, "Failed to allocate memory: read_tileset_file()\n");
+		exit(1);
+	}
+
+	tileset->edge_field_size = header->edge_field_size;
+	tileset->tile_field_size = header->tile_field_size;
+	tileset->table_chunk_bits = header->table_chunk_bits;
+	tileset->tile_table_direction_size = header->tile_table_size / sizeof(BitFieldFrame) / 4;
+	tileset->tile_table = (BitField)(data + header->tile_table_offset);
+	tileset->edge_table = (BitField)(data + header->edge_table_offset);
+	tileset->render_data_table = (uint32_t*)(data + header->render_data_offset);
+	tileset->tile_edges = (uint16_t*)(data + header->tile_edges_offset);
+	tileset->tile_count = header->tile_count;
+	tileset->kernels = tileset_get_kernels(header->tile_field_size);
+
+	tileset->file_data = data;
+	tileset->file_size = size;
+	tileset->file_is_mapped = is_mapped;
+
+	uint8_t* record = data + header->distributions_offset;
+
+	for (int i = 0; i < header->distribution_count; i++) {
+		TilesetFileDistribution* record_header = (TilesetFileDistribution*)record;
+		int weights_size = record_header->tile_field_size * 8 * sizeof(Entropy);
+
+		uint8_t* weights = record + tileset_file_align(sizeof(TilesetFileDistribution));
+		uint8_t* weight_log_weights = weights + tileset_file_align(weights_size);
+		uint8_t* all_tiles = weight_log_weights + tileset_file_align(weights_size);
+
+		distributions[i] = distribution_create(record_header->tile_field_size);
+		distribution_set_weights(distributions[i], (Entropy*)weights, (Entropy*)weight_log_weights, (BitField)all_tiles);
+
+		record += record_header->size;
+	}
+
+	file->tileset = tileset;
+	file->distributions = distributions;
+	file->distribution_count = header->distribution_count;
+
+	return file;
+}
+
+// load a file from memory with one copy, data can be freed afterwards, returns NULL if it can't be used
+TilesetFile* tileset_file_load(void* data, int size) {
+	uint8_t* copy = malloc_inst(size);
+
+	if (copy == NULL) {
+		fprintf(stderr, "Failed to allocate memory: tileset_file_load()\n");
+		exit(1);
+	}
+
+	memcpy(copy, data, size);
+
+	TilesetFile* file = read_tileset_file(copy, size, 0);
+	if (file == NULL) free_inst(copy);
+
+	return file;
+}
+
+#ifndef __EMSCRIPTEN__
+// map a file straight into memory, the tables are only read in as they're used
+// the mapping is private so adding tiles afterwards doesn't write to the file
+TilesetFile* tileset_file_map(const char* path) {
+	int fd = open(path, O_RDONLY);
+
+	if (fd < 0) {
+		fprintf(stderr, "Failed to open %s: tileset_file_map()\n", path);
+		return NULL;
+	}
+
+	struct stat file_stat;
+	if (fstat(fd, &file_stat) != 0 || file_stat.st_size == 0) {
+		fprintf(stderr, "Failed to read %s: tileset_file_map()\n", path);
+		close(fd);
+		return NULL;
+	}
+
+	size_t size = file_stat.st_size;
+	void* data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if (data == MAP_FAILED) {
+		fprintf(stderr, "Failed to map %s: tileset_file_map()\n", path);
+		return NULL;
+	}
+
+	TilesetFile* file = read_tileset_file(data, size, 1);
+	if (file == NULL) munmap(data, size);
+
+	return file;
+}
+#endif
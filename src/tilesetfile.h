@@ -0,0 +1,73 @@
+#ifndef TILESETFILE_GUARD
+#define TILESETFILE_GUARD
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef __EMSCRIPTEN__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "distribution.h"
+#include "meminst.h"
+#include "platform.h"
+#include "tileset.h"
+
+#define TILESET_FILE_MAGIC 0x54434657  // "WFCT" in little endian
+#define TILESET_FILE_VERSION 1
+#define TILESET_FILE_ALIGNMENT 16  // sections start on frame boundaries so their tables are used where they're loaded
+
+#define TILESET_FILE_FIELD_SIZE_LIMIT 512  // bytes, 4096 tiles or edges, keeps the table size of any file from overflowing an int
+
+#define tileset_file_align(a) (((a) + TILESET_FILE_ALIGNMENT - 1) & ~(TILESET_FILE_ALIGNMENT - 1))
+
+// a finished tileset and its distributions, loading one doesn't build any tables
+// offsets and sizes are in bytes from the start of the file, everything is little endian
+typedef struct {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t size;
+	int32_t edge_field_size;
+	int32_t tile_field_size;
+	int32_t table_chunk_bits;
+	int32_t tile_count;
+	int32_t distribution_count;
+	uint32_t tile_table_offset;
+	uint32_t tile_table_size;
+	uint32_t edge_table_offset;
+	uint32_t edge_table_size;
+	uint32_t render_data_offset;
+	uint32_t tile_edges_offset;
+	uint32_t distributions_offset;
+	uint32_t reserved;
+} TilesetFileHeader;
+
+// followed by the distribution's weights, weight * log weights and all_tiles
+// weight tables aren't stored, they're shared through the pool and looked up again when the distribution is loaded
+typedef struct {
+	int32_t tile_field_size;
+	uint32_t size;	// bytes to the next distribution
+	uint32_t reserved[2];
+} TilesetFileDistribution;
+
+// what a file loads into, the tileset and distributions are freed on their own
+typedef struct {
+	Tileset* tileset;
+	Distribution** distributions;
+	int distribution_count;
+} TilesetFile;
+
+extern EMSCRIPTEN_KEEPALIVE void* tileset_file_create(Tileset* tileset, Distribution** distributions, int distribution_count);
+extern EMSCRIPTEN_KEEPALIVE int tileset_file_get_size(void* data);
+extern EMSCRIPTEN_KEEPALIVE TilesetFile* tileset_file_load(void* data, int size);
+#ifndef __EMSCRIPTEN__
+TilesetFile* tileset_file_map(const char* path);
+#endif
+extern EMSCRIPTEN_KEEPALIVE void tileset_file_free(TilesetFile* file);
+
+#endif
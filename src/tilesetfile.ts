@@ -0,0 +1,57 @@
+import { heapU8 } from "./cwrapper";
+import { Distribution } from "./distribution";
+import { freeInst, mallocInst } from "./meminst";
+import { Tileset } from "./tileset";
+
+let tileset_file_create: (tileset: number, distributions: number, distribution_count: number) => number;
+let tileset_file_get_size: (data: number) => number;
+let tileset_file_load: (data: number, size: number) => number;
+let tileset_file_free: (file: number) => void;
+
+export function init() {
+    tileset_file_create = cwrap("tileset_file_create", "number", ["number", "number", "number"]);
+    tileset_file_get_size = cwrap("tileset_file_get_size", "number", ["number"]);
+    tileset_file_load = cwrap("tileset_file_load", "number", ["number", "number"]);
+    tileset_file_free = cwrap("tileset_file_free", null, ["number"]);
+}
+
+// a finished tileset with its tables already built, so it loads without adding every tile again
+export function saveTileset(tileset: Tileset, distributions: Distribution[]): Uint8Array {
+    const distributionsPtr = mallocInst(Math.max(distributions.length, 1) * 4);
+
+    for (let i = 0; i < distributions.length; i++) {
+        setValue(distributionsPtr + i * 4, distributions[i].ptr, "*");
+    }
+
+    const dataPtr = tileset_file_create(tileset.ptr, distributionsPtr, distributions.length);
+    const data = heapU8.slice(dataPtr, dataPtr + tileset_file_get_size(dataPtr));
+
+    freeInst(dataPtr);
+    freeInst(distributionsPtr);
+
+    return data;
+}
+
+export function loadTileset(data: Uint8Array): { tileset: Tileset, distributions: Distribution[] } {
+    const dataPtr = mallocInst(data.length);
+    heapU8.set(data, dataPtr);
+
+    const filePtr = tileset_file_load(dataPtr, data.length);
+    freeInst(dataPtr);
+
+    if (filePtr === 0)
+        throw Error("Not a valid tileset file");
+
+    const tileset = Tileset.fromPtr(getValue(filePtr + 0, "*"));
+    const distributionsPtr = getValue(filePtr + 4, "*");
+    const distributionCount = getValue(filePtr + 8, "i32");
+
+    const distributions: Distribution[] = [];
+    for (let i = 0; i < distributionCount; i++) {
+        distributions.push(Distribution.fromPtr(getValue(distributionsPtr + i * 4, "*"), tileset));
+    }
+
+    tileset_file_free(filePtr);
+
+    return { tileset, distributions };
+}
@@ -7,6 +7,7 @@ void free_chunk(void* chunk) {
 
 void world_free(World* world) {
 	hashmap_free(world->chunks, free_chunk);
+	pthread_rwlock_destroy(&world->chunks_lock);
 	free_inst(world);
 }
 
@@ -28,7 +29,11 @@ int world_set(World* world, int x, int y, int tile) {
 }
 
 Chunk* world_get_chunk(World* world, int x, int y) {
-	return hashmap_get(world->chunks, hashkey_from_pair(x, y));
+	pthread_rwlock_rdlock(&world->chunks_lock);
+	Chunk* chunk = hashmap_get(world->chunks, hashkey_from_pair(x, y));
+	pthread_rwlock_unlock(&world->chunks_lock);
+
+	return chunk;
 }
 
 Chunk* world_create_chunk(World* world, int x, int y) {
@@ -54,13 +59,20 @@ Chunk* world_create_chunk(World* world, int x, int y) {
 	chunk->y = y;
 
 	chunk->is_displayed = 0;
-	chunk->generation_stage = 0;
+	chunk_set_stage(chunk, CHUNK_EMPTY);
 
+	pthread_rwlock_wrlock(&world->chunks_lock);
 	hashmap_set(world->chunks, hashkey_from_pair(x, y), chunk);
+	pthread_rwlock_unlock(&world->chunks_lock);
 
 	return chunk;
 }
 
+// only affects chunks generated from now on
+void world_set_seed(World* world, uint32_t seed) {
+	world->seed = seed;
+}
+
 uint32_t* world_get_chunk_render_data(World* world, Chunk* chunk) {
 	uint32_t* render_data = malloc_inst(world->chunk_size * world->chunk_size * sizeof(uint32_t));
 
@@ -75,19 +87,99 @@ uint32_t* world_get_chunk_render_data(World* world, Chunk* chunk) {
 	return render_data;
 }
 
+// chunk pointers go to the renderer as 32 bit list entries, which only holds in wasm
+// chunks being generated are left out, their tiles are still being written and they're handed over when they're done
+// nothing generates into an empty chunk, so only this thread writes to it
+#ifdef __EMSCRIPTEN__
 List32* world_get_undisplayed_chunks(World* world, int x, int y, int width, int height) {
 	List32* list = list32_create(4);
 
 	for (int u = x; u < x + width; u++) {
 		for (int v = y; v < y + height; v++) {
 			Chunk* chunk = world_get_chunk(world, u, v);
-			if (chunk != NULL && !chunk->is_displayed)
+			if (chunk == NULL) continue;
+
+			int stage = chunk_get_stage(chunk);
+			if (stage != CHUNK_EMPTY && stage != CHUNK_GENERATED && stage != CHUNK_FAILED) continue;
+
+			if (!chunk->is_displayed)
 				list32_push(list, (uint32_t)chunk);
 		}
 	}
 
 	return list;
 }
+#endif
+
+void chunk_window_init(ChunkWindow* window) {
+	window->x = 0;
+	window->y = 0;
+	window->width = 0;
+	window->height = 0;
+	window->capacity = 0;
+	window->chunks = NULL;
+}
+
+void chunk_window_free(ChunkWindow* window) {
+	free_inst(window->chunks);
+	chunk_window_init(window);
+}
+
+// point the window at the chunks under width by height tiles from x, y, the lock is taken once for all of them
+void world_select_chunk_window(World* world, ChunkWindow* window, int x, int y, int width, int height) {
+	window->x = x >> world->chunk_bits;
+	window->y = y >> world->chunk_bits;
+	window->width = ((x + width - 1) >> world->chunk_bits) - window->x + 1;
+	window->height = ((y + height - 1) >> world->chunk_bits) - window->y + 1;
+
+	if (window->width * window->height > window->capacity) {
+		window->capacity = window->width * window->height;
+		window->chunks = realloc_inst(window->chunks, window->capacity * sizeof(Chunk*));
+
+		if (window->chunks == NULL) {
+			fprintf(stderr, "Failed to allocate memory: world_select_chunk_window()\n");
+			exit(1);
+		}
+	}
+
+	pthread_rwlock_rdlock(&world->chunks_lock);
+
+	for (int v = 0; v < window->height; v++) {
+		for (int u = 0; u < window->width; u++) {
+			window->chunks[u + v * window->width] = hashmap_get(world->chunks, hashkey_from_pair(window->x + u, window->y + v));
+		}
+	}
+
+	pthread_rwlock_unlock(&world->chunks_lock);
+}
+
+// chunks outside of the window are looked up in the world
+Chunk* get_window_chunk(World* world, ChunkWindow* window, int x, int y) {
+	int u = (x >> world->chunk_bits) - window->x, v = (y >> world->chunk_bits) - window->y;
+	if (u < 0 || v < 0 || u >= window->width || v >= window->height) return world_get_chunk(world, x >> world->chunk_bits, y >> world->chunk_bits);
+
+	Chunk** chunk = &window->chunks[u + v * window->width];
+	if (*chunk == NULL) *chunk = world_get_chunk(world, x >> world->chunk_bits, y >> world->chunk_bits);
+
+	return *chunk;
+}
+
+int world_window_get(World* world, ChunkWindow* window, int x, int y) {
+	Chunk* chunk = get_window_chunk(world, window, x, y);
+	if (chunk == NULL) return NULL_TILE;
+
+	return chunk->tiles[(x & world->chunk_mask) + (y & world->chunk_mask) * world->chunk_size];
+}
+
+int world_window_set(World* world, ChunkWindow* window, int x, int y, int tile) {
+	Chunk* chunk = get_window_chunk(world, window, x, y);
+	if (chunk == NULL) return 0;
+
+	chunk->tiles[(x & world->chunk_mask) + (y & world->chunk_mask) * world->chunk_size] = tile;
+	chunk->is_displayed = 0;
+
+	return 1;
+}
 
 World* world_create(int chunk_size, Tileset* tileset) {
 	World* world = malloc_inst(sizeof(World));
@@ -108,6 +200,8 @@ World* world_create(int chunk_size, Tileset* tileset) {
 
 	world->chunks = hashmap_create(256);
 	world->tileset = tileset;
+	pthread_rwlock_init(&world->chunks_lock, NULL);
+	world->seed = 0;
 
 	return world;
 }
\ No newline at end of file
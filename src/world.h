@@ -1,18 +1,31 @@
 #ifndef WORLD_GUARD
 #define WORLD_GUARD
 
-#include <emscripten.h>
+#include <pthread.h>
 #include <stdio.h>
 
 #include "bitfield.h"
 #include "hashmap.h"
 #include "list.h"
 #include "meminst.h"
+#include "platform.h"
 #include "tileset.h"
 
 #define NULL_TILE -1
 #define NULL_TILE_RENDER_DATA 0xFFFFFFFF
 
+// how far along a chunk is, stored in generation_stage
+typedef enum {
+	CHUNK_EMPTY,
+	CHUNK_PENDING,		 // queued for generation
+	CHUNK_INITIALIZING,	 // collapse area is being initalized
+	CHUNK_COLLAPSING,
+	CHUNK_GENERATED,
+	CHUNK_FAILED
+} ChunkGenerationStage;
+
+// generation_stage is how a generating thread hands a chunk over, use chunk_get_stage and chunk_set_stage
+// once a chunk is generated or failed its tiles were all written before the stage was
 typedef struct {
 	int x;
 	int y;
@@ -21,16 +34,35 @@ typedef struct {
 	int* tiles;
 } Chunk;
 
+#define chunk_get_stage(chunk) __atomic_load_n(&(chunk)->generation_stage, __ATOMIC_ACQUIRE)
+#define chunk_set_stage(chunk, stage) __atomic_store_n(&(chunk)->generation_stage, stage, __ATOMIC_RELEASE)
+
 typedef struct {
 	int chunk_size;
 	int chunk_bits;
 	int chunk_mask;
 	Hashmap* chunks;
 	Tileset* tileset;
+	pthread_rwlock_t chunks_lock;  // chunks can be looked up from generation threads while new ones are created
+	uint32_t seed;				   // together with its position, decides what a chunk generates into
 } World;
 
+// the chunks under a rectangle of tiles, looked up once so their tiles can be used without taking chunks_lock for each one
+// chunks that didn't exist yet are looked up again when they're used, in case they've been created since
+typedef struct {
+	int x;	// first chunk
+	int y;
+	int width;	// in chunks
+	int height;
+	int capacity;
+	Chunk** chunks;
+} ChunkWindow;
+
 extern EMSCRIPTEN_KEEPALIVE World* world_create(int chunk_size, Tileset* tileset);
+extern EMSCRIPTEN_KEEPALIVE void world_set_seed(World* world, uint32_t seed);
+#ifdef __EMSCRIPTEN__
 extern EMSCRIPTEN_KEEPALIVE List32* world_get_undisplayed_chunks(World* world, int x, int y, int width, int height);
+#endif
 extern EMSCRIPTEN_KEEPALIVE uint32_t* world_get_chunk_render_data(World* world, Chunk* chunk);
 extern EMSCRIPTEN_KEEPALIVE Chunk* world_create_chunk(World* world, int x, int y);
 extern EMSCRIPTEN_KEEPALIVE Chunk* world_get_chunk(World* world, int x, int y);
@@ -38,4 +70,10 @@ extern EMSCRIPTEN_KEEPALIVE int world_set(World* world, int x, int y, int tile);
 extern EMSCRIPTEN_KEEPALIVE int world_get(World* world, int x, int y);
 extern EMSCRIPTEN_KEEPALIVE void world_free(World* world);
 
+void chunk_window_init(ChunkWindow* window);
+void world_select_chunk_window(World* world, ChunkWindow* window, int x, int y, int width, int height);
+int world_window_get(World* world, ChunkWindow* window, int x, int y);
+int world_window_set(World* world, ChunkWindow* window, int x, int y, int tile);
+void chunk_window_free(ChunkWindow* window);
+
 #endif
\ No newline at end of file
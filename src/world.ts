@@ -4,6 +4,7 @@ import { List } from "./list";
 import { DistributionTileset, Tileset } from "./tileset";
 
 let world_create: (chunk_size: number, tileset_ptr: number) => number;
+let world_set_seed: (ptr: number, seed: number) => void;
 let world_get_undisplayed_chunks: (ptr: number, x: number, y: number, width: number, height: number) => number;
 let world_get_chunk_render_data: (worldPtr: number, chunkPtr: number) => number;
 let world_create_chunk: (ptr: number, x: number, y: number) => number;
@@ -18,6 +19,7 @@ const worldRegistry = new FinalizationRegistry((ptr: number) => {
 
 export function init() {
     world_create = cwrap("world_create", "number", ["number", "number"]);
+    world_set_seed = cwrap("world_set_seed", null, ["number", "number"]);
     world_get_undisplayed_chunks = cwrap("world_get_undisplayed_chunks", "number", ["number", "number", "number", "number", "number"]);
     world_get_chunk_render_data = cwrap("world_get_chunk_render_data", "number", ["number", "number"]);
     world_create_chunk = cwrap("world_create_chunk", "number", ["number", "number", "number"]);
@@ -32,8 +34,10 @@ export class World {
     readonly chunkSize: number
     readonly tileset: Tileset;
 
-    static create(chunkSize: number, tileset: Tileset, _?: number): World {
+    // the same seed always generates the same world, one is picked at random if it isn't given
+    static create(chunkSize: number, tileset: Tileset, seed?: number): World {
         const world = new World(world_create(chunkSize, tileset.ptr), tileset);
+        world.seed = seed ?? Math.floor(Math.random() * 0x100000000);
         worldRegistry.register(world, world.ptr, world);
         return world;
     }
@@ -44,6 +48,10 @@ export class World {
         this.chunkSize = getValue(this.ptr + 0, "i32");;
     }
 
+    set seed(seed: number) {
+        world_set_seed(this.ptr, seed >>> 0);
+    }
+
     getUndisplayedChunks(x: number, y: number, width: number, height: number): Chunk[] {
         const chunkPtrs = new List(world_get_undisplayed_chunks(this.ptr, x, y, width, height), 4);
         const chunks = [];
@@ -116,6 +124,15 @@ export class DistributionWorld extends World {
     }
 }
 
+export enum ChunkGenerationStage {
+    Empty = 0,
+    Pending = 1,
+    Initializing = 2,
+    Collapsing = 3,
+    Generated = 4,
+    Failed = 5
+}
+
 export class Chunk {
     readonly ptr: number;
     readonly world: World;
@@ -137,6 +154,11 @@ export class Chunk {
         setValue(this.ptr + 8, isDisplayed ? 1 : 0, "i32");
     }
 
+    // written by generation threads, see chunk_set_stage
+    get generationStage(): ChunkGenerationStage {
+        return Atomics.load(heap32, (this.ptr + 12) >> 2);
+    }
+
     getRenderData(): { data: Int32Array, ptr: number } {
         const ptr = world_get_chunk_render_data(this.world.ptr, this.ptr);
         const tileArea = this.world.chunkSize ** 2;
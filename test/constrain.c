@@ -0,0 +1,122 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../src/bitfield.h"
+#include "../src/random.h"
+#include "../src/tileset.h"
+
+// every constrain kernel has to remove exactly the tiles without a matching edge and report them, build and run with make test
+// the removed tiles have to be the tiles before without the tiles after, whatever kernel and table layout the tileset uses
+
+#define FIELD_COUNT 64
+#define EDGE_FIELD_SIZE 2
+
+int failures = 0, runs = 0;
+
+// tiles with random edges out of edge_count, every tile of the field is used
+Tileset* create_random_tileset(int tile_field_size, int table_chunk_bits, int edge_count, RandomStream* random) {
+	Tileset* tileset = tileset_create_with_chunk_bits(EDGE_FIELD_SIZE, tile_field_size, table_chunk_bits);
+
+	for (int tile = 0; tile < tile_field_size * 8; tile++) {
+		int right = random_below(random, edge_count), top = random_below(random, edge_count);
+		int left = random_below(random, edge_count), bottom = random_below(random, edge_count);
+		tileset_add_tile(tileset, tile, 0, right, top, left, bottom);
+	}
+
+	return tileset;
+}
+
+// about one in density of the first bit_count bits set, the rest are cleared
+void fill_random(BitField field, int field_size, int bit_count, int density, RandomStream* random) {
+	field_clear(field, field_size);
+
+	for (int bit = 0; bit < bit_count; bit++) {
+		if (random_below(random, density) == 0) field_set_bit(field, bit);
+	}
+}
+
+// constrains random tile fields by random edge fields and checks each tile against the tileset's edges
+void check_kernel(const char* name, int tile_field_size, int table_chunk_bits, int seed) {
+	RandomStream random;
+	random_stream_seed(&random, seed, tile_field_size, table_chunk_bits);
+
+	int edge_count = 6;
+	Tileset* tileset = create_random_tileset(tile_field_size, table_chunk_bits, edge_count, &random);
+
+	BitField before = field_create(tile_field_size);
+	BitField after = field_create(tile_field_size);
+	BitField removed = field_create(tile_field_size);
+	BitField edge_field = field_create(EDGE_FIELD_SIZE);
+
+	for (int i = 0; i < FIELD_COUNT; i++) {
+		int direction = i % 4;
+
+		// some fields lose every tile, some none of them
+		fill_random(before, tile_field_size, tile_field_size * 8, 1 + i % 3, &random);
+		fill_random(edge_field, EDGE_FIELD_SIZE, edge_count, 1 + i % 5, &random);
+
+		field_copy(after, before, tile_field_size);
+		fill_random(removed, tile_field_size, tile_field_size * 8, 2, &random);
+
+		int changes = tileset_constrain_tile_removed(tileset, after, edge_field, direction, removed);
+		int wrong = 0, any_removed = 0, any_left = 0;
+
+		for (int tile = 0; tile < tile_field_size * 8; tile++) {
+			int was_set = field_get_bit(before, tile);
+			int matches = field_get_bit(edge_field, tileset_get_tile_edge(tileset, tile, direction));
+
+			if (field_get_bit(after, tile) != (was_set && matches)) wrong++;
+			if (field_get_bit(removed, tile) != (was_set && !field_get_bit(after, tile))) wrong++;
+
+			any_removed |= was_set && !matches;
+			any_left |= was_set && matches;
+		}
+
+		int expected_changes = (any_removed ? FIELD_CHANGED : 0) | (any_left ? 0 : FIELD_EMPTY);
+		runs++;
+
+		if (wrong > 0 || changes != expected_changes) {
+			printf("%s %d bit chunks seed %d field %d: %d wrong tiles, returned %d instead of %d\n", name, table_chunk_bits, seed, i, wrong, changes, expected_changes);
+			failures++;
+		}
+
+		// without removed it has to leave the same tiles
+		field_copy(removed, before, tile_field_size);
+		int plain_changes = tileset_constrain_tile(tileset, removed, edge_field, direction);
+		runs++;
+
+		if (memcmp(removed, after, tile_field_size) != 0 || plain_changes != changes) {
+			printf("%s %d bit chunks seed %d field %d: tileset_constrain_tile differs from tileset_constrain_tile_removed\n", name, table_chunk_bits, seed, i);
+			failures++;
+		}
+	}
+
+	free_inst(before);
+	free_inst(after);
+	free_inst(removed);
+	free_inst(edge_field);
+	tileset_free(tileset);
+}
+
+int main() {
+	// bytes, 1, 2 and 4 frames have their own kernels, 3 and 8 go through the generic one in one part block and in two blocks
+	int tile_field_sizes[5] = {16, 32, 64, 48, 128};
+	const char* kernel_names[5] = {"1 frame", "2 frame", "4 frame", "generic 3 frame", "generic 8 frame"};
+	int chunk_bits[3] = {8, 4, 1};
+
+	for (int s = 0; s < 5; s++) {
+		if (s < 3 && tileset_get_kernels(tile_field_sizes[s]) == tileset_get_kernels(48)) {
+			printf("%s fields don't have their own kernel\n", kernel_names[s]);
+			failures++;
+		}
+
+		for (int c = 0; c < 3; c++) {
+			for (int seed = 1; seed <= 4; seed++) {
+				check_kernel(kernel_names[s], tile_field_sizes[s], chunk_bits[c], seed);
+			}
+		}
+	}
+
+	printf("%d of %d constrains went as expected\n", runs - failures, runs);
+	return failures > 0;
+}
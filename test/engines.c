@@ -0,0 +1,276 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../src/entropies.h"
+#include "../src/random.h"
+#include "../src/scheduler.h"
+#include "../src/superposition.h"
+#include "../src/tileset.h"
+#include "../src/world.h"
+
+// both propagation engines have to generate the same world from the same seed with the heap, build and run with make test
+// the bucket queue breaks ties in its own order, so its worlds are only checked to be whole and the same on any number of threads
+// the road tileset never contradicts, the random ones contradict often so backtracking is covered as well
+
+#define TILE_COUNT 9
+#define TILESET_COUNT 4
+#define CHUNKS_ACROSS 3
+
+const char* engine_names[2] = {"table", "support"};
+const char* queue_names[2] = {"heap", "buckets"};
+
+int edges[TILESET_COUNT][TILE_COUNT][4];
+int weights[TILESET_COUNT][TILE_COUNT];
+
+// tileset 0 is the road tileset, the others have random edges and weights
+void make_tiles() {
+	int dirt = 0, road = 1;
+	int road_edges[TILE_COUNT][4] = {{dirt, dirt, dirt, dirt}, {dirt, dirt, dirt, dirt}, {dirt, road, dirt, road}, {road, dirt, road, dirt}, {dirt, dirt, dirt, road}, {dirt, road, dirt, dirt}, {dirt, dirt, road, dirt}, {road, dirt, dirt, dirt}, {road, road, road, road}};
+	int road_weights[TILE_COUNT] = {50, 10, 10, 10, 2, 2, 2, 2, 1};
+
+	for (int tileset_index = 0; tileset_index < TILESET_COUNT; tileset_index++) {
+		RandomStream random;
+		random_stream_seed(&random, tileset_index, 0, 0);
+
+		for (int tile = 0; tile < TILE_COUNT; tile++) {
+			for (int side = 0; side < 4; side++) {
+				edges[tileset_index][tile][side] = tileset_index == 0 ? road_edges[tile][side] : (int)random_below(&random, 3);
+			}
+
+			weights[tileset_index][tile] = tileset_index == 0 ? road_weights[tile] : 1 + (int)random_below(&random, 20);
+		}
+	}
+}
+
+Tileset* create_tileset(int tileset_index) {
+	Tileset* tileset = tileset_create(1, 2);
+
+	for (int tile = 0; tile < TILE_COUNT; tile++) {
+		int* tile_edges = edges[tileset_index][tile];
+		tileset_add_tile(tileset, tile, 0, tile_edges[0], tile_edges[1], tile_edges[2], tile_edges[3]);
+	}
+
+	return tileset;
+}
+
+DistributionArea* create_distribution_area(int tileset_index) {
+	Distribution* distribution = distribution_create(2);
+
+	for (int tile = 0; tile < TILE_COUNT; tile++) {
+		distribution_add_tile(distribution, tile, weights[tileset_index][tile]);
+	}
+
+	Distribution** distributions = malloc_inst(sizeof(Distribution*));
+	distributions[0] = distribution;
+
+	return distribution_area_create(distributions, 1 << 20, 1);
+}
+
+void free_distribution_area(DistributionArea* area) {
+	distribution_free(area->distributions[0]);
+	distribution_area_free(area);
+}
+
+// tiles that aren't set and edges that don't match in a width by width square from x0, y0
+int count_problems(World* world, int tileset_index, int x0, int y0, int width) {
+	int problems = 0;
+
+	for (int y = y0; y < y0 + width; y++) {
+		for (int x = x0; x < x0 + width; x++) {
+			int tile = world_get(world, x, y);
+
+			if (tile < 0) {
+				problems++;
+				continue;
+			}
+
+			int right = x + 1 < x0 + width ? world_get(world, x + 1, y) : -1;
+			int up = y + 1 < y0 + width ? world_get(world, x, y + 1) : -1;
+
+			if (right >= 0 && edges[tileset_index][tile][0] != edges[tileset_index][right][2]) problems++;
+			if (up >= 0 && edges[tileset_index][tile][1] != edges[tileset_index][up][3]) problems++;
+		}
+	}
+
+	return problems;
+}
+
+// generates one chunk and copies its tiles into out, returns what the last collapse returned and the problems found in it
+int generate(int tileset_index, int size, int seed, PropagationEngine engine, EntropyQueue queue, int* out, int* problems) {
+	Tileset* tileset = create_tileset(tileset_index);
+	DistributionArea* area = create_distribution_area(tileset_index);
+
+	World* world = world_create(size, tileset);
+	world_set_seed(world, seed);
+	world_create_chunk(world, 0, 0);
+
+	Superposition* superposition = superposition_create(world);
+	superposition_set_propagation_engine(superposition, engine);
+	superposition_set_entropy_queue(superposition, queue);
+	superposition_select_distribution_area(superposition, 0, 0, area);
+	superposition_select_collapse_area(superposition, 0, 0, size, size);
+
+	int result;
+	while ((result = superposition_collapse_tiles(superposition, size * size)) == COLLAPSE_UNFINISHED);
+
+	for (int y = 0; y < size; y++) {
+		for (int x = 0; x < size; x++) {
+			out[x + y * size] = world_get(world, x, y);
+		}
+	}
+
+	*problems = count_problems(world, tileset_index, 0, 0, size);
+
+	superposition_free(superposition);
+	free_distribution_area(area);
+	world_free(world);
+	tileset_free(tileset);
+
+	return result;
+}
+
+// generates a square of chunks with the bucket queue on a scheduler, every other chunk so none of them share a border
+// that way no chunk depends on the order the others were generated in, and the world can't depend on the thread count
+// returns the problems found in the chunks
+int generate_threaded(int thread_count, int size, int seed, int* out) {
+	Tileset* tileset = create_tileset(0);
+	DistributionArea* area = create_distribution_area(0);
+
+	World* world = world_create(size, tileset);
+	world_set_seed(world, seed);
+
+	Scheduler* scheduler = scheduler_create(world, -(1 << 19), -(1 << 19), area, thread_count);
+
+	// workers don't touch their superpositions until a chunk is queued
+	for (int i = 0; i < thread_count; i++) {
+		superposition_set_entropy_queue(scheduler->workers[i].superposition, ENTROPY_QUEUE_BUCKETS);
+	}
+
+	for (int y = 0; y < CHUNKS_ACROSS; y++) {
+		for (int x = 0; x < CHUNKS_ACROSS; x++) {
+			scheduler_queue_chunk(scheduler, x * 2, y * 2);
+		}
+	}
+
+	scheduler_wait(scheduler);
+
+	int problems = scheduler_get_failed(scheduler);
+	for (int y = 0; y < CHUNKS_ACROSS; y++) {
+		for (int x = 0; x < CHUNKS_ACROSS; x++) {
+			problems += count_problems(world, 0, x * 2 * size, y * 2 * size, size);
+		}
+	}
+
+	int width = CHUNKS_ACROSS * 2 * size;
+	for (int y = 0; y < width; y++) {
+		for (int x = 0; x < width; x++) {
+			out[x + y * width] = world_get(world, x, y);
+		}
+	}
+
+	scheduler_free(scheduler);
+	free_distribution_area(area);
+	world_free(world);
+	tileset_free(tileset);
+
+	return problems;
+}
+
+int main() {
+	int sizes[2] = {16, 32};
+	int failures = 0, runs = 0;
+
+	make_tiles();
+
+	for (int tileset_index = 0; tileset_index < TILESET_COUNT; tileset_index++) {
+		for (int s = 0; s < 2; s++) {
+			for (int seed = 1; seed <= 4; seed++) {
+				int size = sizes[s];
+				int* expected = malloc_inst(size * size * sizeof(int));
+				int* tiles = malloc_inst(size * size * sizeof(int));
+
+				if (expected == NULL || tiles == NULL) {
+					fprintf(stderr, "Failed to allocate memory: main()\n");
+					exit(1);
+				}
+
+				int problems;
+				int expected_result = generate(tileset_index, size, seed, PROPAGATION_TABLE, ENTROPY_QUEUE_HEAP, expected, &problems);
+
+				for (int engine = PROPAGATION_TABLE; engine <= PROPAGATION_SUPPORT; engine++) {
+					for (int queue = ENTROPY_QUEUE_HEAP; queue <= ENTROPY_QUEUE_BUCKETS; queue++) {
+						int result = generate(tileset_index, size, seed, engine, queue, tiles, &problems);
+						runs++;
+
+						// a failed area keeps whatever it had, only finished ones have to be whole
+						if (result == COLLAPSE_FINISHED && problems > 0) {
+							printf("tileset %d %2dx%-2d seed %d: %s %s has %d bad edges or unset tiles\n", tileset_index, size, size, seed, engine_names[engine], queue_names[queue], problems);
+							failures++;
+							continue;
+						}
+
+						if (queue == ENTROPY_QUEUE_BUCKETS) {
+							if (tileset_index == 0 && result != COLLAPSE_FINISHED) {
+								printf("tileset 0 %2dx%-2d seed %d: %s buckets failed on a tileset that can't contradict\n", size, size, seed, engine_names[engine]);
+								failures++;
+							}
+
+							continue;
+						}
+
+						int differences = 0;
+						for (int i = 0; i < size * size; i++) {
+							if (tiles[i] != expected[i]) differences++;
+						}
+
+						if (result != expected_result || differences > 0) {
+							printf("tileset %d %2dx%-2d seed %d: %s heap differs from table heap in %d tiles\n", tileset_index, size, size, seed, engine_names[engine], differences);
+							failures++;
+						}
+					}
+				}
+
+				free_inst(expected);
+				free_inst(tiles);
+			}
+		}
+	}
+
+	int size = 16, width = CHUNKS_ACROSS * 2 * size;
+	int* expected = malloc_inst(width * width * sizeof(int));
+	int* tiles = malloc_inst(width * width * sizeof(int));
+
+	if (expected == NULL || tiles == NULL) {
+		fprintf(stderr, "Failed to allocate memory: main()\n");
+		exit(1);
+	}
+
+	for (int thread_count = 1; thread_count <= 8; thread_count *= 2) {
+		int problems = generate_threaded(thread_count, size, 1, thread_count == 1 ? expected : tiles);
+		runs++;
+
+		if (problems > 0) {
+			printf("buckets on %d threads has %d failed chunks, bad edges or unset tiles\n", thread_count, problems);
+			failures++;
+			continue;
+		}
+
+		if (thread_count == 1) continue;
+
+		int differences = 0;
+		for (int i = 0; i < width * width; i++) {
+			if (tiles[i] != expected[i]) differences++;
+		}
+
+		if (differences > 0) {
+			printf("buckets on %d threads differs from 1 thread in %d tiles\n", thread_count, differences);
+			failures++;
+		}
+	}
+
+	free_inst(expected);
+	free_inst(tiles);
+
+	printf("%d of %d runs passed\n", runs - failures, runs);
+	return failures > 0;
+}
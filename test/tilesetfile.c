@@ -0,0 +1,124 @@
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../src/distribution.h"
+#include "../src/tileset.h"
+#include "../src/tilesetfile.h"
+
+// a saved tileset has to load back the same, and truncated or corrupt files have to be turned away, build and run with make test
+// the loader prints why it turns each file away, make test hides those
+
+#define TILE_COUNT 9
+
+int failures = 0, runs = 0;
+
+// loads a copy of data with one change made to it, the file has to be turned away
+void expect_rejected(const char* name, uint8_t* data, int size, int offset, const void* value, int value_size) {
+	uint8_t* copy = malloc_inst(size);
+
+	if (copy == NULL) {
+		fprintf(stderr, "Failed to allocate memory: expect_rejected()\n");
+		exit(1);
+	}
+
+	memcpy(copy, data, size);
+	memcpy(copy + offset, value, value_size);
+
+	TilesetFile* file = tileset_file_load(copy, size);
+	runs++;
+
+	if (file != NULL) {
+		printf("%s was loaded\n", name);
+		failures++;
+
+		tileset_free(file->tileset);
+		for (int i = 0; i < file->distribution_count; i++) distribution_free(file->distributions[i]);
+		tileset_file_free(file);
+	}
+
+	free_inst(copy);
+}
+
+int main() {
+	int dirt = 0, road = 1;
+	int edges[TILE_COUNT][4] = {{dirt, dirt, dirt, dirt}, {dirt, dirt, dirt, dirt}, {dirt, road, dirt, road}, {road, dirt, road, dirt}, {dirt, dirt, dirt, road}, {dirt, road, dirt, dirt}, {dirt, dirt, road, dirt}, {road, dirt, dirt, dirt}, {road, road, road, road}};
+	int weights[TILE_COUNT] = {50, 10, 10, 10, 2, 2, 2, 2, 1};
+
+	Tileset* tileset = tileset_create(1, 2);
+	Distribution* distribution = distribution_create(2);
+
+	for (int tile = 0; tile < TILE_COUNT; tile++) {
+		tileset_add_tile(tileset, tile, 0, edges[tile][0], edges[tile][1], edges[tile][2], edges[tile][3]);
+		distribution_add_tile(distribution, tile, weights[tile]);
+	}
+
+	uint8_t* data = tileset_file_create(tileset, &distribution, 1);
+	int size = tileset_file_get_size(data);
+	TilesetFileHeader* header = (TilesetFileHeader*)data;
+
+	// the file as it was saved
+	TilesetFile* file = tileset_file_load(data, size);
+	runs++;
+
+	if (file == NULL || file->tileset->tile_count != TILE_COUNT || file->distribution_count != 1) {
+		printf("the saved file didn't load back\n");
+		failures++;
+	} else {
+		for (int tile = 0; tile < TILE_COUNT; tile++) {
+			for (int direction = 0; direction < 4; direction++) {
+				if (tileset_get_tile_edge(file->tileset, tile, direction) != edges[tile][direction]) {
+					printf("tile %d loaded with the wrong edge in direction %d\n", tile, direction);
+					failures++;
+				}
+			}
+		}
+
+		tileset_free(file->tileset);
+		distribution_free(file->distributions[0]);
+		tileset_file_free(file);
+	}
+
+	// every length short of the whole file
+	for (int length = 0; length < size; length++) {
+		TilesetFile* truncated = tileset_file_load(data, length);
+		runs++;
+
+		if (truncated != NULL) {
+			printf("the file cut to %d of %d bytes was loaded\n", length, size);
+			failures++;
+		}
+	}
+
+	uint32_t past_end = size, unaligned = header->tile_edges_offset + 1, huge = 0xFFFFFFF0;
+	int32_t negative = -1, zero = 0, too_big = TILESET_FILE_FIELD_SIZE_LIMIT + 1;
+	uint16_t bad_edge = header->edge_field_size * 8;
+	int32_t other_field_size = header->tile_field_size * 2;
+
+	expect_rejected("a file with a bad magic", data, size, offsetof(TilesetFileHeader, magic), &zero, sizeof(zero));
+	expect_rejected("a file with a bad version", data, size, offsetof(TilesetFileHeader, version), &zero, sizeof(zero));
+	expect_rejected("a file longer than its buffer", data, size, offsetof(TilesetFileHeader, size), &huge, sizeof(huge));
+	expect_rejected("a file without edges", data, size, offsetof(TilesetFileHeader, edge_field_size), &zero, sizeof(zero));
+	expect_rejected("a file with too many tiles", data, size, offsetof(TilesetFileHeader, tile_field_size), &too_big, sizeof(too_big));
+	expect_rejected("a file with a negative tile count", data, size, offsetof(TilesetFileHeader, tile_count), &negative, sizeof(negative));
+	expect_rejected("a file with a table past its end", data, size, offsetof(TilesetFileHeader, tile_table_offset), &past_end, sizeof(past_end));
+	expect_rejected("a file with an overflowing edge table", data, size, offsetof(TilesetFileHeader, edge_table_offset), &huge, sizeof(huge));
+	expect_rejected("a file with unaligned tile edges", data, size, offsetof(TilesetFileHeader, tile_edges_offset), &unaligned, sizeof(unaligned));
+	expect_rejected("a file with more distributions than it holds", data, size, offsetof(TilesetFileHeader, distribution_count), &too_big, sizeof(too_big));
+
+	// the last tile's last edge, and one past the edges for the first tile
+	expect_rejected("a file with an edge past the edge fields", data, size, header->tile_edges_offset + (TILE_COUNT * 4 - 1) * sizeof(uint16_t), &bad_edge, sizeof(bad_edge));
+	expect_rejected("a file with an edge past the edge fields", data, size, header->tile_edges_offset, &bad_edge, sizeof(bad_edge));
+
+	uint32_t record = header->distributions_offset;
+	expect_rejected("a distribution for other tiles", data, size, record + offsetof(TilesetFileDistribution, tile_field_size), &other_field_size, sizeof(other_field_size));
+	expect_rejected("a distribution with the wrong size", data, size, record + offsetof(TilesetFileDistribution, size), &zero, sizeof(zero));
+	expect_rejected("a distribution with a negative weight", data, size, record + tileset_file_align(sizeof(TilesetFileDistribution)), &negative, sizeof(negative));
+
+	free_inst(data);
+	distribution_free(distribution);
+	tileset_free(tileset);
+
+	printf("%d of %d tileset file loads went as expected\n", runs - failures, runs);
+	return failures > 0;
+}
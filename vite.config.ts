@@ -1,6 +1,14 @@
 import { child_process } from "vite-plugin-child-process"
 
+// shared memory for the generation threads needs a cross origin isolated page
+const crossOriginIsolation = {
+    "Cross-Origin-Opener-Policy": "same-origin",
+    "Cross-Origin-Embedder-Policy": "require-corp",
+};
+
 export default {
+    server: { headers: crossOriginIsolation },
+    preview: { headers: crossOriginIsolation },
     plugins: [child_process({
         name: "make",
         command: ["make"],